@@ -0,0 +1,641 @@
+// Benchmarks da DataStructLib
+// Compilar: g++ -std=c++17 -O2 -pthread Benchmark.cpp -o benchmark
+// Uso: ./benchmark [nome]   (sem argumento roda todos)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <set>
+#include <shared_mutex>
+#include <sstream>
+#include <stack>
+#include <thread>
+#include <vector>
+#include "include/DataStructLib.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedMs(Clock::time_point a, Clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+// Evita que o compilador descarte resultados calculados só para medir
+static volatile std::size_t sink;
+
+// ===================================================
+// Skip list concorrente vs BST protegida por shared_mutex
+// ===================================================
+
+// Executa `ops` operações por thread com `leituraPct`% de contains e o resto
+// dividido entre insert e remove. Retorna milhões de operações por segundo.
+template <typename Op>
+static double runMix(int threads, int leituraPct, int ops, int universo, Op op) {
+    std::vector<std::thread> ts;
+    const auto ini = Clock::now();
+    for (int t = 0; t < threads; ++t) {
+        ts.emplace_back([=, &op] {
+            std::mt19937 gen(1234u + static_cast<unsigned>(t));
+            std::uniform_int_distribution<int> chave(0, universo - 1);
+            std::uniform_int_distribution<int> pct(0, 99);
+            for (int i = 0; i < ops; ++i) {
+                const int p = pct(gen);
+                const int k = chave(gen);
+                if (p < leituraPct) op(0, k);
+                else if ((p - leituraPct) % 2 == 0) op(1, k);
+                else op(2, k);
+            }
+        });
+    }
+    for (auto& t : ts) t.join();
+    const double seg = elapsedMs(ini, Clock::now()) / 1000.0;
+    return (static_cast<double>(threads) * ops) / seg / 1e6;
+}
+
+static void benchSkipList() {
+    const int universo = 200000;
+    const int ops = 200000;
+    std::printf("\n[skiplist] Mops/s (universo %d chaves, metade pré-carregada)\n", universo);
+    std::printf("%8s %8s %14s %14s\n", "threads", "leitura", "SkipList", "BST+rwlock");
+
+    for (int leitura : { 90, 50 }) {
+        for (int threads : { 1, 2, 4, 8 }) {
+            ConcurrentSkipList<int> sl;
+            BST<int> bst;
+            bst.setBalancePolicy(BalancePolicy::Scapegoat);
+            std::shared_mutex mtx;
+            for (int k = 0; k < universo; k += 2) { sl.insert(k); bst.insert(k); }
+
+            const double a = runMix(threads, leitura, ops, universo, [&](int tipo, int k) {
+                if (tipo == 0) sink = sl.contains(k);
+                else if (tipo == 1) sl.insert(k);
+                else sl.remove(k);
+            });
+            const double b = runMix(threads, leitura, ops, universo, [&](int tipo, int k) {
+                if (tipo == 0) {
+                    std::shared_lock<std::shared_mutex> lock(mtx);
+                    sink = bst.contains(k);
+                } else {
+                    std::unique_lock<std::shared_mutex> lock(mtx);
+                    if (tipo == 1) bst.insert(k);
+                    else bst.remove(k);
+                }
+            });
+            std::printf("%8d %7d%% %14.2f %14.2f\n", threads, leitura, a, b);
+        }
+    }
+}
+
+// ===================================================
+// LinkedList (um elemento por nó) vs UnrolledLinkedList
+// ===================================================
+
+static void benchUnrolled() {
+    const int n = 1000000;
+    std::printf("\n[unrolled] %d elementos int\n", n);
+
+    LinkedList<int> lista;
+    UnrolledLinkedList<int> desenrolada;
+    for (int i = 0; i < n; ++i) { lista.insertStart(i); desenrolada.insertStart(i); }
+
+    auto a = Clock::now();
+    std::size_t soma = 0;
+    for (int rep = 0; rep < 10; ++rep)
+        for (Node<int>* p = lista.getHead(); p != nullptr; p = p->getLink()) soma += p->getInfo();
+    auto b = Clock::now();
+    for (int rep = 0; rep < 10; ++rep)
+        for (int x : desenrolada) soma += x;
+    auto c = Clock::now();
+    sink = soma;
+    std::printf("  iteração (10x):        LinkedList %8.2f ms | Unrolled %8.2f ms\n",
+                elapsedMs(a, b), elapsedMs(b, c));
+
+    // Pilha: rajadas de push seguidas de pop
+    a = Clock::now();
+    {
+        Stack<int> s;
+        for (int rep = 0; rep < 20; ++rep) {
+            for (int i = 0; i < n / 10; ++i) s.push(i);
+            for (int i = 0; i < n / 10; ++i) soma += s.pop();
+        }
+    }
+    b = Clock::now();
+    {
+        Stack<int, UnrolledLinkedList<int>> s;
+        for (int rep = 0; rep < 20; ++rep) {
+            for (int i = 0; i < n / 10; ++i) s.push(i);
+            for (int i = 0; i < n / 10; ++i) soma += s.pop();
+        }
+    }
+    c = Clock::now();
+    std::printf("  Stack push/pop (4M):   LinkedList %8.2f ms | Unrolled %8.2f ms\n",
+                elapsedMs(a, b), elapsedMs(b, c));
+
+    // Fila em regime: 64 elementos circulando (insertEnd da LinkedList é O(n))
+    a = Clock::now();
+    {
+        Queue<int> q;
+        for (int i = 0; i < 64; ++i) q.enqueue(i);
+        for (int i = 0; i < n; ++i) { q.enqueue(i); soma += q.dequeue(); }
+    }
+    b = Clock::now();
+    {
+        Queue<int, UnrolledLinkedList<int>> q;
+        for (int i = 0; i < 64; ++i) q.enqueue(i);
+        for (int i = 0; i < n; ++i) { q.enqueue(i); soma += q.dequeue(); }
+    }
+    c = Clock::now();
+    sink = soma;
+    std::printf("  Queue churn (1M, 64):  LinkedList %8.2f ms | Unrolled %8.2f ms\n",
+                elapsedMs(a, b), elapsedMs(b, c));
+}
+
+// ===================================================
+// Stack (lista) vs InlineStack vs std::stack<std::vector>
+// ===================================================
+
+// Simula uma DFS rasa: sobe e desce até a profundidade máxima repetidamente
+template <typename S, typename Push, typename Pop>
+static double runShallow(int voltas, int profundidade, Push push, Pop pop) {
+    const auto ini = Clock::now();
+    std::size_t soma = 0;
+    for (int v = 0; v < voltas; ++v) {
+        S s;
+        for (int d = 0; d < profundidade; ++d) push(s, d);
+        for (int d = 0; d < profundidade; ++d) soma += pop(s);
+    }
+    sink = soma;
+    return elapsedMs(ini, Clock::now());
+}
+
+static void benchInlineStack() {
+    const int voltas = 200000;
+    std::printf("\n[inlinestack] %d voltas de push/pop, tempo em ms\n", voltas);
+    std::printf("%12s %12s %12s %12s\n", "profundidade", "Stack", "InlineStack", "std::stack");
+    for (int prof : { 8, 32, 64, 256 }) {
+        const double a = runShallow<Stack<int>>(voltas, prof,
+            [](Stack<int>& s, int x) { s.push(x); },
+            [](Stack<int>& s) { return s.pop(); });
+        const double b = runShallow<InlineStack<int, 64>>(voltas, prof,
+            [](InlineStack<int, 64>& s, int x) { s.push(x); },
+            [](InlineStack<int, 64>& s) { return s.pop(); });
+        const double c = runShallow<std::stack<int, std::vector<int>>>(voltas, prof,
+            [](std::stack<int, std::vector<int>>& s, int x) { s.push(x); },
+            [](std::stack<int, std::vector<int>>& s) { int x = s.top(); s.pop(); return x; });
+        std::printf("%12d %12.2f %12.2f %12.2f\n", prof, a, b, c);
+    }
+}
+
+// ===================================================
+// BST::containsBatch (AMAC) vs laço de contains
+// ===================================================
+
+static void benchBatchLookup() {
+    std::printf("\n[batch] containsBatch vs laço de contains (árvore com chaves aleatórias)\n");
+    std::printf("%10s %10s %12s %12s %8s\n", "nós", "buscas", "laço (ms)", "lote (ms)", "ganho");
+    std::mt19937 gen(42);
+    for (int n : { 100000, 1000000, 4000000 }) {
+        BST<int> arvore;
+        std::uniform_int_distribution<int> dist(0, 4 * n);
+        for (int i = 0; i < n; ++i) arvore.insert(dist(gen));
+
+        std::vector<int> chaves(1000000);
+        for (auto& k : chaves) k = dist(gen);
+
+        auto a = Clock::now();
+        std::size_t achou = 0;
+        for (int k : chaves) achou += arvore.contains(k);
+        auto b = Clock::now();
+        std::vector<bool> bits;
+        arvore.containsBatch(chaves, bits);
+        auto c = Clock::now();
+        std::size_t achouLote = 0;
+        for (bool x : bits) achouLote += x;
+        if (achou != achouLote) std::printf("  ERRO: resultados diferentes\n");
+        sink = achou;
+        std::printf("%10d %10zu %12.2f %12.2f %7.2fx\n", n, chaves.size(),
+                    elapsedMs(a, b), elapsedMs(b, c), elapsedMs(a, b) / elapsedMs(b, c));
+    }
+}
+
+// ===================================================
+// PriorityQueue: operações em lote vs laços de chamadas unitárias
+// ===================================================
+
+static void benchPriorityBatch() {
+    const int n = 50000;
+    const std::size_t bloco = 1000;
+    std::printf("\n[pqbatch] %d jobs, prioridades 0..999, tempo em ms\n", n);
+    std::printf("%-28s %12s %12s\n", "", "unitário", "lote");
+
+    std::mt19937 gen(99);
+    std::uniform_int_distribution<unsigned int> prio(0, 999);
+    std::vector<std::pair<int, unsigned int>> jobs(n);
+    for (int i = 0; i < n; ++i) jobs[i] = { i, prio(gen) };
+
+    PriorityQueue<int> a, b;
+    auto t0 = Clock::now();
+    for (const auto& j : jobs) a.enqueue(j.first, j.second);
+    auto t1 = Clock::now();
+    b.enqueueRange(jobs.begin(), jobs.end());
+    auto t2 = Clock::now();
+    std::printf("%-28s %12.2f %12.2f\n", "enqueue vs enqueueRange", elapsedMs(t0, t1), elapsedMs(t1, t2));
+
+    // Metade sai em blocos de `bloco`, o resto de uma vez
+    std::size_t soma = 0;
+    std::vector<int> saida;
+    t0 = Clock::now();
+    for (int i = 0; i < n / 2; ++i) soma += a.dequeue();
+    t1 = Clock::now();
+    while (saida.size() < static_cast<std::size_t>(n / 2)) b.dequeueBatch(bloco, saida);
+    t2 = Clock::now();
+    std::printf("%-28s %12.2f %12.2f\n", "dequeue vs dequeueBatch", elapsedMs(t0, t1), elapsedMs(t1, t2));
+
+    t0 = Clock::now();
+    while (!a.isEmpty()) soma += a.dequeue();
+    t1 = Clock::now();
+    const std::vector<int> resto = b.drainAll();
+    t2 = Clock::now();
+    std::printf("%-28s %12.2f %12.2f\n", "dequeue até vazia vs drainAll", elapsedMs(t0, t1), elapsedMs(t1, t2));
+    sink = soma + saida.size() + resto.size();
+}
+
+// ===================================================
+// SPSCRing vs Queue protegida por mutex (um produtor, um consumidor)
+// ===================================================
+
+static std::uint64_t agoraNs() {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+// Cada item é o instante em que foi produzido; o consumidor guarda a
+// latência de todos. Imprime itens/s e percentis de latência.
+template <typename Push, typename Pop>
+static void runSpsc(const char* nome, std::size_t n, Push push, Pop pop) {
+    std::vector<std::uint64_t> lat;
+    lat.reserve(n);
+    const auto ini = Clock::now();
+    std::thread consumidor([&] {
+        std::uint64_t buf[64];
+        while (lat.size() < n) {
+            const std::size_t k = pop(buf, 64);
+            if (k == 0) { std::this_thread::yield(); continue; }
+            const std::uint64_t t = agoraNs();
+            for (std::size_t i = 0; i < k; ++i) lat.push_back(t - buf[i]);
+        }
+    });
+    for (std::size_t i = 0; i < n;) {
+        if (push(agoraNs())) ++i;
+        else std::this_thread::yield();
+    }
+    consumidor.join();
+    const double seg = elapsedMs(ini, Clock::now()) / 1000.0;
+    std::sort(lat.begin(), lat.end());
+    auto pct = [&](double p) { return lat[static_cast<std::size_t>(p * (lat.size() - 1))] / 1000.0; };
+    std::printf("%-24s %12.2f %10.1f %10.1f %10.1f\n", nome, n / seg / 1e6, pct(0.5), pct(0.99), pct(0.999));
+}
+
+static void benchSpsc() {
+    const std::size_t n = 2000000;
+    std::printf("\n[spsc] %zu itens, 1 produtor / 1 consumidor\n", n);
+    std::printf("%-24s %12s %10s %10s %10s\n", "", "Mitens/s", "p50 (us)", "p99 (us)", "p99.9 (us)");
+
+    {
+        SPSCRing<std::uint64_t> anel(4096);
+        runSpsc("SPSCRing tryPush/tryPop", n,
+                [&](std::uint64_t x) { return anel.tryPush(x); },
+                [&](std::uint64_t* out, std::size_t max) {
+                    std::size_t k = 0;
+                    while (k < max && anel.tryPop(out[k])) ++k;
+                    return k;
+                });
+    }
+    {
+        SPSCRing<std::uint64_t> anel(4096);
+        runSpsc("SPSCRing popBatch", n,
+                [&](std::uint64_t x) { return anel.tryPush(x); },
+                [&](std::uint64_t* out, std::size_t max) { return anel.popBatch(out, max); });
+    }
+    {
+        // Limitada ao mesmo tamanho do anel para comparar igual com igual
+        Queue<std::uint64_t, UnrolledLinkedList<std::uint64_t>> fila;
+        std::size_t tam = 0;
+        std::mutex mtx;
+        runSpsc("Queue + mutex", n,
+                [&](std::uint64_t x) {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    if (tam == 4096) return false;
+                    fila.enqueue(x);
+                    ++tam;
+                    return true;
+                },
+                [&](std::uint64_t* out, std::size_t max) {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    std::size_t k = 0;
+                    while (k < max && tam > 0) { out[k++] = fila.dequeue(); --tam; }
+                    return k;
+                });
+    }
+
+    // Pipeline de três estágios
+    const int itens = 1000000;
+    auto p = makePipeline<int>(4096)
+                 .then([](int x) { return x * 3; })
+                 .then([](int x) { return static_cast<long long>(x) + 1; })
+                 .then([](long long x) { return x % 1000; });
+    const auto ini = Clock::now();
+    std::thread produtor([&] {
+        for (int i = 0; i < itens; ++i) p.push(i);
+        p.close();
+    });
+    long long soma = 0, x = 0;
+    while (p.pop(x)) soma += x;
+    produtor.join();
+    sink = static_cast<std::size_t>(soma);
+    std::printf("%-24s %12.2f\n", "Pipeline (3 estágios)", itens / (elapsedMs(ini, Clock::now()) / 1000.0) / 1e6);
+}
+
+// ===================================================
+// BST::clone vs reinserção das chaves em pré-ordem
+// ===================================================
+
+static void benchClone() {
+    std::printf("\n[clone] clone() vs nova árvore inserindo preOrder(), tempo em ms\n");
+    std::printf("%10s %14s %12s %14s %14s\n", "nós", "reinserção", "clone()", "busca (reins.)", "busca (clone)");
+    std::mt19937 gen(7);
+    for (int n : { 100000, 1000000 }) {
+        BST<int> arvore;
+        std::uniform_int_distribution<int> dist(0, 4 * n);
+        for (int i = 0; i < n; ++i) arvore.insert(dist(gen));
+
+        auto a = Clock::now();
+        BST<int> copia;
+        for (int k : arvore.preOrder()) copia.insert(k);
+        auto b = Clock::now();
+        BST<int> clone = arvore.clone();
+        auto c = Clock::now();
+
+        // O clone fica contíguo em pré-ordem; a reinserção espalha os nós
+        std::vector<int> chaves(1000000);
+        for (auto& k : chaves) k = dist(gen);
+        std::size_t achou = 0;
+        auto d = Clock::now();
+        for (int k : chaves) achou += copia.contains(k);
+        auto e = Clock::now();
+        for (int k : chaves) achou += clone.contains(k);
+        auto f = Clock::now();
+        sink = achou;
+        std::printf("%10d %14.2f %12.2f %14.2f %14.2f\n", n, elapsedMs(a, b), elapsedMs(b, c),
+                    elapsedMs(d, e), elapsedMs(e, f));
+    }
+}
+
+// ===================================================
+// Buscas com distribuição de Zipf: BST simples vs scapegoat vs splay
+// ===================================================
+
+static void benchZipf() {
+    const int n = 1000000;
+    const int buscas = 2000000;
+    std::printf("\n[zipf] %d chaves, %d buscas Zipf(s) sobre chaves em posições aleatórias, tempo em ms\n",
+                n, buscas);
+    std::printf("%6s %12s %12s %12s %14s\n", "s", "simples", "scapegoat", "splay", "splay (k=16)");
+
+    std::mt19937 gen(11);
+    std::vector<int> chaves(n);
+    for (int i = 0; i < n; ++i) chaves[i] = i * 4;
+    std::shuffle(chaves.begin(), chaves.end(), gen);
+
+    BST<int> simples, bode, splay, splay16;
+    bode.setBalancePolicy(BalancePolicy::Scapegoat);
+    splay.setBalancePolicy(BalancePolicy::Splay);
+    splay16.setBalancePolicy(BalancePolicy::Splay);
+    splay16.setSplayPeriod(16);
+    for (int k : chaves) { simples.insert(k); bode.insert(k); splay.insert(k); splay16.insert(k); }
+
+    // A chave de posto r (1 = mais quente) é quentes[r - 1], embaralhada de
+    // novo: a ordem de inserção deixaria as quentes perto da raiz
+    std::vector<int> quentes = chaves;
+    std::shuffle(quentes.begin(), quentes.end(), gen);
+
+    for (double expoente : { 0.8, 1.0, 1.2 }) {
+        std::vector<double> acumulada(n);
+        double soma = 0;
+        for (int r = 0; r < n; ++r) acumulada[r] = (soma += 1.0 / std::pow(r + 1.0, expoente));
+        std::uniform_real_distribution<double> u(0.0, soma);
+        std::vector<int> consulta(buscas);
+        for (auto& q : consulta) {
+            const auto r = std::lower_bound(acumulada.begin(), acumulada.end(), u(gen)) - acumulada.begin();
+            q = quentes[static_cast<std::size_t>(r)];
+        }
+
+        auto mede = [&](const BST<int>& t) {
+            std::size_t achou = 0;
+            const auto ini = Clock::now();
+            for (int q : consulta) achou += t.contains(q);
+            sink = achou;
+            return elapsedMs(ini, Clock::now());
+        };
+        const double a = mede(simples);
+        const double b = mede(bode);
+        const double c = mede(splay);
+        // Com k = 16 as buscas só anotam o splay; quem escreve o aplica. Aqui
+        // o laço faz esse papel a cada 16 buscas.
+        std::size_t achou = 0;
+        const auto ini = Clock::now();
+        for (std::size_t i = 0; i < consulta.size(); ++i) {
+            achou += splay16.contains(consulta[i]);
+            if (i % 16 == 15) splay16.applyPendingSplay();
+        }
+        sink = achou;
+        const double d = elapsedMs(ini, Clock::now());
+        std::printf("%6.1f %12.2f %12.2f %12.2f %14.2f\n", expoente, a, b, c, d);
+    }
+}
+
+// ===================================================
+// BTree (nós largos) vs BST scapegoat vs std::set
+// ===================================================
+
+template <typename Arvore>
+static void runOrdered(const char* nome, const std::vector<int>& chaves, const std::vector<int>& consulta) {
+    Arvore t;
+    auto a = Clock::now();
+    for (int k : chaves) t.insert(k);
+    auto b = Clock::now();
+    std::size_t achou = 0;
+    for (int q : consulta) achou += t.contains(q);
+    auto c = Clock::now();
+    // Varredura de intervalos curtos: lowerBound + 100 passos do iterador
+    long long soma = 0;
+    for (std::size_t i = 0; i < consulta.size() / 100; ++i) {
+        auto it = t.lowerBound(consulta[i]);
+        for (int p = 0; p < 100 && it != t.end(); ++p, ++it) soma += *it;
+    }
+    auto d = Clock::now();
+    for (std::size_t i = 0; i < chaves.size(); i += 2) t.remove(chaves[i]);
+    auto e = Clock::now();
+    sink = achou + static_cast<std::size_t>(soma);
+    std::printf("%-18s %10.2f %10.2f %10.2f %10.2f\n", nome, elapsedMs(a, b), elapsedMs(b, c),
+                elapsedMs(c, d), elapsedMs(d, e));
+}
+
+// Adaptadores para que BST (com scapegoat) e std::set usem a mesma interface
+struct BstScapegoat : BST<int> {
+    BstScapegoat() { setBalancePolicy(BalancePolicy::Scapegoat); }
+};
+struct StdSet : std::set<int> {
+    bool contains(int k) const { return count(k) != 0; }
+    const_iterator lowerBound(int k) const { return lower_bound(k); }
+    void remove(int k) { erase(k); }
+};
+
+static void benchBTree() {
+    const int n = 1000000;
+    std::printf("\n[btree] %d chaves aleatórias, 2M buscas, 20k varreduras de 100, remoção de metade; ms\n", n);
+    std::printf("%-18s %10s %10s %10s %10s\n", "estrutura", "inserção", "busca", "varredura", "remoção");
+    std::mt19937 gen(13);
+    std::uniform_int_distribution<int> dist(0, 8 * n);
+    std::vector<int> chaves(n), consulta(2000000);
+    for (auto& k : chaves) k = dist(gen);
+    for (auto& q : consulta) q = dist(gen);
+
+    runOrdered<BTree<int, 256>>("BTree<int,256>", chaves, consulta);
+    runOrdered<BTree<int, 512>>("BTree<int,512>", chaves, consulta);
+    runOrdered<BstScapegoat>("BST scapegoat", chaves, consulta);
+    runOrdered<StdSet>("std::set", chaves, consulta);
+}
+
+// ===================================================
+// HashedBST: carga mista dominada por contains
+// ===================================================
+
+template <typename Conjunto>
+static void runMixed(const char* nome, const std::vector<int>& carga, const std::vector<int>& ops) {
+    Conjunto s;
+    auto a = Clock::now();
+    for (int k : carga) s.insert(k);
+    auto b = Clock::now();
+    std::size_t achou = 0;
+    for (std::size_t i = 0; i < ops.size(); ++i) {
+        const int k = ops[i];
+        switch (i % 10) {
+        case 0: s.insert(k); break;
+        case 1: s.remove(k); break;
+        default: achou += s.contains(k); break;
+        }
+    }
+    auto c = Clock::now();
+    // Varreduras curtas: o índice não atrapalha as operações ordenadas
+    long long soma = 0;
+    for (std::size_t i = 0; i < 20000; ++i) {
+        auto it = s.lowerBound(ops[i]);
+        for (int j = 0; j < 100 && it != s.end(); ++j, ++it) soma += *it;
+    }
+    auto d = Clock::now();
+    sink = achou + static_cast<std::size_t>(soma);
+    std::printf("%-18s %10.2f %10.2f %10.1f %10.2f\n", nome, elapsedMs(a, b), elapsedMs(b, c),
+                ops.size() / elapsedMs(b, c) / 1000.0, elapsedMs(c, d));
+}
+
+static void benchHashed() {
+    const int n = 1000000;
+    std::printf("\n[hashed] %d chaves; 4M ops (80%% contains, 10%% insert, 10%% remove); 20k varreduras de 100\n", n);
+    std::printf("%-18s %10s %10s %10s %10s\n", "estrutura", "carga ms", "mista ms", "Mops/s", "varr. ms");
+    std::mt19937 gen(21);
+    std::uniform_int_distribution<int> dist(0, 2 * n);
+    std::vector<int> carga(n), ops(4000000);
+    for (auto& k : carga) k = dist(gen);
+    for (auto& k : ops) k = dist(gen);
+
+    runMixed<HashedBST<int>>("HashedBST", carga, ops);
+    runMixed<BstScapegoat>("BST scapegoat", carga, ops);
+    runMixed<StdSet>("std::set", carga, ops);
+}
+
+// ===================================================
+// Impressão: iostream elemento a elemento vs FormatBuffer
+// ===================================================
+
+template <typename List>
+static void runFormat(const char* nome, const List& l) {
+    std::ostringstream os;
+    auto a = Clock::now();
+    os << "Itens da lista: ";
+    for (const auto& x : l) os << x << " ";
+    auto b = Clock::now();
+    std::string s1;
+    {
+        FormatBuffer out(s1);
+        formatRange(out, l.begin(), l.end(), FormatOptions::classic());
+    }
+    auto c = Clock::now();
+    std::string s2;
+    {
+        FormatBuffer out(s2);
+        formatParallel(out, l.begin(), l.end(), FormatOptions::classic());
+    }
+    auto d = Clock::now();
+    sink = os.str().size() + s1.size() + s2.size();
+    std::printf("%-24s %10.2f %12.2f %10.2f %10.1f\n", nome, elapsedMs(a, b), elapsedMs(b, c), elapsedMs(c, d),
+                static_cast<double>(s1.size()) / (1 << 20));
+}
+
+static void benchFormat() {
+    const int n = 1000000;
+    std::printf("\n[format] %d elementos formatados em memória, ms (%u threads)\n", n,
+                std::thread::hardware_concurrency());
+    std::printf("%-24s %10s %12s %10s %10s\n", "lista", "iostream", "FormatBuffer", "paralelo", "MiB");
+    std::mt19937_64 gen(17);
+    LinkedList<int> li;
+    UnrolledLinkedList<long long> ul;
+    LinkedList<double> ld;
+    for (int i = 0; i < n; ++i) {
+        li.insertStart(static_cast<int>(gen()));
+        ul.insertEnd(static_cast<long long>(gen() >> 8));
+        ld.insertStart(static_cast<double>(gen() % 1000000) / 7.0);
+    }
+    runFormat("LinkedList<int>", li);
+    runFormat("Unrolled<long long>", ul);
+    runFormat("LinkedList<double>", ld);
+}
+
+int main(int argc, char** argv) {
+    struct Caso {
+        const char* nome;
+        void (*fn)();
+    };
+    const Caso casos[] = {
+        { "skiplist", benchSkipList },
+        { "unrolled", benchUnrolled },
+        { "inlinestack", benchInlineStack },
+        { "batch", benchBatchLookup },
+        { "pqbatch", benchPriorityBatch },
+        { "spsc", benchSpsc },
+        { "clone", benchClone },
+        { "zipf", benchZipf },
+        { "btree", benchBTree },
+        { "format", benchFormat },
+        { "hashed", benchHashed },
+    };
+
+    const char* filtro = argc > 1 ? argv[1] : nullptr;
+    bool rodou = false;
+    for (const auto& c : casos) {
+        if (filtro && std::strcmp(filtro, c.nome) != 0) continue;
+        c.fn();
+        rodou = true;
+    }
+    if (!rodou) {
+        std::printf("Benchmark desconhecido: %s\nDisponíveis:", filtro);
+        for (const auto& c : casos) std::printf(" %s", c.nome);
+        std::printf("\n");
+        return 1;
+    }
+    return 0;
+}
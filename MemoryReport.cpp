@@ -0,0 +1,133 @@
+// Relatório de memória dos contêineres da DataStructLib
+// Compilar: g++ -std=c++17 -O2 -pthread MemoryReport.cpp -o memreport
+// Imprime bytes por elemento (dado, estrutura e o que o alocador reservou)
+// de cada contêiner em vários tamanhos, para comparar layouts.
+// "alocador/el" é o cálculo de memoryUsage(); "medido/el" é o que o
+// AllocationCounter registrou de fato para os blocos do contêiner, e
+// "frag" a fração livre do heap do processo (mallinfo2) naquele momento.
+
+#include <cstdio>
+#include <string>
+#include "include/DataStructLib.hpp"
+
+static AllocationCounter contador;
+static std::size_t base = 0;
+
+// Marca o início da medição do próximo contêiner
+static void inicio() {
+    base = contador.allocatorBytes.load();
+}
+
+static void linha(const char* nome, std::size_t n, const MemoryUsage& m) {
+    const double e = n ? static_cast<double>(n) : 1.0;
+    const double medido = static_cast<double>(contador.allocatorBytes.load() - base);
+    std::printf("%-28s %9zu %9.1f %9.1f %9.1f %11.1f %10.1f %5.1f%%\n", nome, n,
+                m.payloadBytes / e, m.overheadBytes / e, m.totalBytes() / e, m.allocatorBytes / e,
+                medido / e, 100.0 * heapStats().fragmentation());
+}
+
+static std::string texto(std::size_t i) {
+    // Metade cabe no buffer interno da std::string, metade vai para o heap
+    return (i % 2 ? std::string("chave-longa-o-bastante-para-heap-") : std::string("k")) + std::to_string(i);
+}
+
+int main() {
+    setAllocationCounter(&contador);
+    std::printf("%-28s %9s %9s %9s %9s %11s %10s %6s\n", "contêiner", "n", "dado/el", "estr/el", "total/el",
+                "alocador/el", "medido/el", "frag");
+    std::printf("(medido/el não inclui o heap que os próprios elementos alocam, como o buffer de std::string)\n\n");
+    for (std::size_t n : { 1000u, 10000u, 100000u, 1000000u }) {
+        {
+            inicio();
+            LinkedList<int> l;
+            for (std::size_t i = 0; i < n; ++i) l.insertStart(static_cast<int>(i));
+            linha("LinkedList<int>", n, l.memoryUsage());
+        }
+        {
+            inicio();
+            UnrolledLinkedList<int> l;
+            for (std::size_t i = 0; i < n; ++i) l.insertEnd(static_cast<int>(i));
+            linha("UnrolledLinkedList<int>", n, l.memoryUsage());
+        }
+        {
+            inicio();
+            Stack<int> s;
+            for (std::size_t i = 0; i < n; ++i) s.push(static_cast<int>(i));
+            linha("Stack<int>", n, s.memoryUsage());
+        }
+        {
+            inicio();
+            InlineStack<int> is;
+            for (std::size_t i = 0; i < n; ++i) is.push(static_cast<int>(i));
+            linha("InlineStack<int>", n, is.memoryUsage());
+        }
+        {
+            inicio();
+            BST<int> t;
+            t.setBalancePolicy(BalancePolicy::Scapegoat);
+            for (std::size_t i = 0; i < n; ++i) t.insert(static_cast<int>(i));
+            linha("BST<int>", n, t.memoryUsage());
+        }
+        {
+            // Fluxo com muitas repetições: 1000 chaves distintas
+            inicio();
+            BST<int> t;
+            t.setBalancePolicy(BalancePolicy::Scapegoat);
+            t.setMultiset(true);
+            for (std::size_t i = 0; i < n; ++i) t.insert(static_cast<int>(i % 1000));
+            linha("BST<int> multiset", n, t.memoryUsage());
+        }
+        {
+            inicio();
+            HashedBST<int> t;
+            for (std::size_t i = 0; i < n; ++i) t.insert(static_cast<int>(i));
+            linha("HashedBST<int>", n, t.memoryUsage());
+        }
+        {
+            inicio();
+            BTree<int> t;
+            for (std::size_t i = 0; i < n; ++i) t.insert(static_cast<int>(i));
+            linha("BTree<int>", n, t.memoryUsage());
+        }
+        {
+            inicio();
+            BSTMap<int, double> mapa;
+            mapa.tree().setBalancePolicy(BalancePolicy::Scapegoat);
+            for (std::size_t i = 0; i < n; ++i) mapa[static_cast<int>(i)] = 1.0;
+            linha("BSTMap<int,double>", n, mapa.memoryUsage());
+            // inOrder copia pares com chave const: confere que o percurso monta
+            if (mapa.inOrder().size() != n) std::printf("BSTMap::inOrder divergiu de size()\n");
+        }
+        {
+            inicio();
+            ConcurrentSkipList<int> sl;
+            for (std::size_t i = 0; i < n; ++i) sl.insert(static_cast<int>(i));
+            linha("ConcurrentSkipList<int>", n, sl.memoryUsage());
+        }
+        {
+            std::vector<std::pair<std::string, unsigned int>> lote;
+            for (std::size_t i = 0; i < n; ++i) lote.emplace_back(texto(i), static_cast<unsigned int>(i % 7));
+            PriorityQueue<std::string> pq;
+            inicio();
+            pq.enqueueAll(lote.begin(), lote.end());
+            linha("PriorityQueue<std::string>", n, pq.memoryUsage());
+        }
+        if (n <= 100000) {
+            {
+                inicio();
+                PersistentBST<int> p;
+                for (std::size_t i = 0; i < n; ++i) p.insert(static_cast<int>(i));
+                linha("PersistentBST<int>", n, p.memoryUsage());
+            }
+            inicio();
+            BST<std::string> ts;
+            ts.setBalancePolicy(BalancePolicy::Scapegoat);
+            for (std::size_t i = 0; i < n; ++i) ts.insert(texto(i));
+            linha("BST<std::string>", n, ts.memoryUsage());
+        }
+        std::printf("\n");
+    }
+    std::printf("blocos ainda vivos no contador: %zu\n", contador.liveBlocks.load());
+    setAllocationCounter(nullptr);
+    return 0;
+}
@@ -0,0 +1,222 @@
+// Verificações rápidas da DataStructLib (casos que já deram defeito)
+// Compilar: g++ -std=c++17 -O1 -g -fsanitize=address,undefined -pthread SelfTest.cpp -o selftest
+// Cada verificação imprime seu nome; uma falha aborta com a expressão.
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <sstream>
+#include <string>
+#include "include/DataStructLib.hpp"
+
+#define CONFERE(expr)                                                            \
+    do {                                                                         \
+        if (!(expr)) {                                                           \
+            std::fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #expr); \
+            std::abort();                                                        \
+        }                                                                        \
+    } while (0)
+
+// Ordem sem distinção de maiúsculas
+struct SemCaixa {
+    bool operator()(const std::string& a, const std::string& b) const {
+        const std::size_t n = std::min(a.size(), b.size());
+        for (std::size_t i = 0; i < n; ++i) {
+            const int x = std::tolower(static_cast<unsigned char>(a[i]));
+            const int y = std::tolower(static_cast<unsigned char>(b[i]));
+            if (x != y) return x < y;
+        }
+        return a.size() < b.size();
+    }
+};
+
+// Hash coerente com SemCaixa
+struct HashSemCaixa {
+    std::size_t operator()(const std::string& s) const {
+        std::string t(s);
+        for (char& c : t) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return std::hash<std::string>()(t);
+    }
+};
+
+// HashedBST com Compare não padrão: com std::hash o índice discorda da
+// árvore, mas nada pode ser indexado duas vezes
+static void hashedComparador() {
+    {
+        HashedBST<std::string, std::hash<std::string>, SemCaixa> t;
+        CONFERE(t.insert("abc"));
+        CONFERE(!t.insert("ABC"));
+        CONFERE(t.size() == 1);
+        CONFERE(t.contains("abc"));
+        CONFERE(t.remove("abc"));
+        CONFERE(!t.contains("abc"));
+        CONFERE(t.empty());
+    }
+    {
+        HashedBST<std::string, HashSemCaixa, SemCaixa> t;
+        CONFERE(t.insert("abc"));
+        CONFERE(!t.insert("ABC"));
+        CONFERE(t.contains("aBc"));
+        CONFERE(t.size() == 1);
+        t.setMultiset(true);
+        CONFERE(!t.insert("Abc"));
+        CONFERE(t.count("ABC") == 2);
+        CONFERE(t.erase("abc") == 2);
+        CONFERE(t.empty());
+    }
+    std::printf("hashed com comparador: ok\n");
+}
+
+// Percursos repetem a chave pela multiplicidade, inclusive para tipos sem
+// atribuição por cópia (os pares de BSTMap têm chave const)
+static void percursos() {
+    BST<int> t;
+    t.setMultiset(true);
+    for (int k : { 5, 3, 5, 8, 3, 5 }) t.insert(k);
+    CONFERE((t.inOrder() == std::vector<int>{ 3, 3, 5, 5, 5, 8 }));
+    CONFERE(t.preOrder().size() == 6 && t.postOrder().size() == 6);
+
+    BSTMap<std::string, int> mapa;
+    mapa["b"] = 2;
+    mapa["a"] = 1;
+    mapa["c"] = 3;
+    const auto pares = mapa.inOrder();
+    CONFERE(pares.size() == 3);
+    CONFERE(pares[0].first == "a" && pares[1].second == 2 && pares[2].first == "c");
+    std::printf("percursos: ok\n");
+}
+
+// imprimeLista/printStack respeitam os manipuladores de std::cout
+static void impressaoComManipuladores() {
+    LinkedList<int> l;
+    l.insertEnd(255);
+    l.insertEnd(16);
+    InlineStack<int> p;
+    p.push(255);
+    p.push(16);
+
+    std::ostringstream capt;
+    std::streambuf* antigo = std::cout.rdbuf(capt.rdbuf());
+    std::cout << std::hex;
+    l.imprimeLista();
+    p.printStack();
+    std::cout << std::dec;
+    l.imprimeLista();
+    std::cout.rdbuf(antigo);
+    CONFERE(capt.str() == "\nItens da lista: ff 10 \n\nItens da lista: 10 ff \n\nItens da lista: 255 16 \n");
+    std::printf("impressão com manipuladores: ok\n");
+}
+
+// Estágios movem os resultados (aceita tipo só-movível) e uma exceção
+// num estágio chega a pop em vez de derrubar o processo
+static void pipeline() {
+    {
+        // push e pop na mesma thread: tudo precisa caber nos anéis
+        auto p = makePipeline<int>(256).then([](int x) { return std::make_unique<int>(x * 2); });
+        for (int i = 0; i < 100; ++i) p.push(i);
+        p.close();
+        std::unique_ptr<int> r;
+        long soma = 0;
+        while (p.pop(r)) soma += *r;
+        CONFERE(soma == 9900);
+    }
+    {
+        auto p = makePipeline<int>(64)
+                     .then([](int x) {
+                         if (x == 50) throw std::runtime_error("estágio");
+                         return x;
+                     })
+                     .then([](int x) { return std::to_string(x); });
+        for (int i = 0; i < 1000; ++i) p.push(i);
+        p.close();
+        std::string s;
+        std::size_t lidos = 0;
+        bool lancou = false;
+        try {
+            while (p.pop(s)) ++lidos;
+        } catch (const std::runtime_error& e) {
+            lancou = std::string(e.what()) == "estágio";
+        }
+        CONFERE(lancou);
+        CONFERE(lidos <= 50);
+    }
+    std::printf("pipeline: ok\n");
+}
+
+// Elemento cuja cópia lança na n-ésima vez (o move não é noexcept)
+struct Fragil {
+    static int copias;
+    static int vivos;
+    int v = 0;
+    Fragil(int x) : v(x) { ++vivos; }
+    Fragil(const Fragil& o) : v(o.v) {
+        if (--copias == 0) throw std::runtime_error("cópia");
+        ++vivos;
+    }
+    Fragil(Fragil&& o) : v(o.v) { ++vivos; }
+    ~Fragil() { --vivos; }
+};
+int Fragil::copias = 0;
+int Fragil::vivos = 0;
+
+struct alignas(32) Largo {
+    int v = 0;
+};
+
+// InlineStack::grow: falha no meio não perde nem destrói duas vezes, e
+// tipos superalinhados recebem buffer alinhado
+static void inlineStackGrow() {
+    {
+        InlineStack<Fragil, 4> p;
+        for (int i = 0; i < 4; ++i) p.push(Fragil(i));
+        Fragil::copias = 3;
+        bool lancou = false;
+        try {
+            p.reserve(16);
+        } catch (const std::runtime_error&) {
+            lancou = true;
+        }
+        CONFERE(lancou);
+        CONFERE(p.size() == 4 && p.capacity() == 4);
+        CONFERE(p.top().v == 3);
+        CONFERE(Fragil::vivos == 4);
+    }
+    CONFERE(Fragil::vivos == 0);
+    {
+        InlineStack<Largo, 2> p;
+        for (int i = 0; i < 100; ++i) p.push(Largo{ i });
+        CONFERE(reinterpret_cast<std::uintptr_t>(&p.top()) % 32 == 0);
+        CONFERE(p.pop().v == 99);
+    }
+    std::printf("InlineStack::grow: ok\n");
+}
+
+// Os backends de conjunto aceitam contains por referência const
+template <typename Set>
+static bool temChave(const Set& s, int k) {
+    return s.contains(k);
+}
+
+static void containsConst() {
+    ConcurrentSkipList<int> sl;
+    BST<int> t;
+    for (int k : { 4, 8, 15 }) {
+        sl.insert(k);
+        t.insert(k);
+    }
+    CONFERE(temChave(sl, 8) && !temChave(sl, 9));
+    CONFERE(temChave(t, 15) && !temChave(t, 16));
+    std::printf("contains const: ok\n");
+}
+
+int main() {
+    hashedComparador();
+    percursos();
+    impressaoComManipuladores();
+    pipeline();
+    inlineStackGrow();
+    containsConst();
+    return 0;
+}
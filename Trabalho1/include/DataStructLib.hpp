@@ -373,6 +373,22 @@ public:
     BST() : root(nullptr) {}
     ~BST() { destroy(root); }
 
+    // Cópia proibida (dois donos liberariam os mesmos nós); mover só
+    // transfere a raiz, então devolver uma árvore por valor é seguro
+    BST(const BST&) = delete;
+    BST& operator=(const BST&) = delete;
+
+    BST(BST&& other) noexcept : root(other.root) { other.root = nullptr; }
+
+    BST& operator=(BST&& other) noexcept {
+        if (this != &other) {
+            destroy(root);
+            root = other.root;
+            other.root = nullptr;
+        }
+        return *this;
+    }
+
     void insert_Node(const T& value) {
         Node** cur = &root;
         while (*cur != nullptr) {
@@ -421,9 +437,9 @@ public:
 
     BST<T> randomIntTree(int n){
         BST<T> tree;
-        random_device rand;
-        mt19937 gen(rand());
-        uniform_int_distribution<> dist(-100, 100);
+        std::random_device rand;
+        std::mt19937 gen(rand());
+        std::uniform_int_distribution<> dist(-100, 100);
         
         for(int i = 0; i<n; i++){
             tree.insert_Node(dist(gen));
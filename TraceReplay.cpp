@@ -0,0 +1,179 @@
+// Reprodução de traços de operações da DataStructLib
+// Compilar: g++ -std=c++17 -O2 -pthread TraceReplay.cpp -o replay
+// Uso: ./replay traço.bin [backend...]          (sem backend roda todos os compatíveis)
+//      ./replay --gerar tipo traço.bin [n]      grava um traço sintético de exemplo
+//                                               (tipo: conjunto, fila, pilha, prioridade)
+// Para cada backend imprime, por operação, contagem, média, p50, p99 e
+// máximo em ns, além do checksum dos resultados (backends corretos
+// concordam entre si).
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "include/DataStructLib.hpp"
+
+// std::set com a interface de conjunto esperada por applyTraceRecord
+struct StdSet : std::set<long long> {
+    bool remove(long long k) { return erase(k) != 0; }
+    bool contains(long long k) const { return count(k) != 0; }
+};
+
+static std::uint32_t mascara(std::initializer_list<TraceOp> ops) {
+    std::uint32_t m = 0;
+    for (TraceOp op : ops) m |= 1u << static_cast<unsigned>(op);
+    return m;
+}
+
+template <typename Backend>
+static TraceReplayReport rodar(const std::vector<TraceRecord>& traco) {
+    Backend b;
+    return replayTrace(traco, b);
+}
+
+template <BalancePolicy P>
+static TraceReplayReport rodarBST(const std::vector<TraceRecord>& traco) {
+    BST<long long> t;
+    t.setBalancePolicy(P);
+    return replayTrace(traco, t);
+}
+
+struct Backend {
+    const char* nome;
+    std::uint32_t ops;  // operações que o backend sabe aplicar
+    TraceReplayReport (*fn)(const std::vector<TraceRecord>&);
+};
+
+static void imprime(const char* nome, const TraceReplayReport& r) {
+    std::printf("\n[%s] %llu ops em %.2f ms, checksum %llu\n", nome, static_cast<unsigned long long>(r.ops),
+                r.totalNs / 1e6, static_cast<unsigned long long>(r.checksum));
+    std::printf("%-10s %10s %10s %10s %10s %12s\n", "op", "n", "média", "p50", "p99", "máx");
+    for (std::size_t i = 0; i < kTraceOps; ++i) {
+        const LatencyHistogram& h = r.perOp[i];
+        if (h.count == 0) continue;
+        std::printf("%-10s %10llu %10.1f %10llu %10llu %12llu\n", traceOpName(static_cast<TraceOp>(i)),
+                    static_cast<unsigned long long>(h.count), h.meanNs(),
+                    static_cast<unsigned long long>(h.percentileNs(0.5)),
+                    static_cast<unsigned long long>(h.percentileNs(0.99)),
+                    static_cast<unsigned long long>(h.maxNs));
+    }
+}
+
+// Cargas sintéticas gravadas pelos próprios wrappers Recording*
+static int gerar(const char* tipo, const char* caminho, std::size_t n) {
+    std::mt19937_64 gen(42);
+    TraceWriter w(caminho);
+    if (std::strcmp(tipo, "conjunto") == 0) {
+        // Janela de chaves que anda devagar: deltas pequenos, 1-2 bytes por chave
+        BST<long long> t;
+        t.setBalancePolicy(BalancePolicy::Scapegoat);
+        RecordingBST<long long> rt(t, w);
+        for (std::size_t i = 0; i < n; ++i) {
+            const long long k = static_cast<long long>(i / 4 + gen() % 4096);
+            const unsigned sorteio = gen() % 100;
+            if (sorteio < 60) rt.contains(k);
+            else if (sorteio < 85) rt.insert(k);
+            else rt.remove(k);
+        }
+    } else if (std::strcmp(tipo, "fila") == 0) {
+        Queue<long long> q;
+        RecordingQueue<long long> rq(q, w);
+        for (std::size_t i = 0; i < n; ++i) {
+            if (gen() % 2 || q.isEmpty()) rq.enqueue(static_cast<long long>(i));
+            else rq.dequeue();
+        }
+    } else if (std::strcmp(tipo, "pilha") == 0) {
+        Stack<long long> s;
+        RecordingStack<long long> rs(s, w);
+        for (std::size_t i = 0; i < n; ++i) {
+            if (gen() % 2 || s.isEmpty()) rs.push(static_cast<long long>(i));
+            else rs.pop();
+        }
+    } else if (std::strcmp(tipo, "prioridade") == 0) {
+        PriorityQueue<long long> pq;
+        RecordingPriorityQueue<long long> rp(pq, w);
+        for (std::size_t i = 0; i < n; ++i) {
+            if (gen() % 2 || pq.isEmpty()) rp.enqueue(static_cast<long long>(i), static_cast<unsigned>(gen() % 100));
+            else rp.dequeue();
+        }
+    } else {
+        std::printf("Tipo desconhecido: %s\n", tipo);
+        return 1;
+    }
+    w.flush();
+    if (!w.ok()) {
+        std::printf("Falha ao gravar %s\n", caminho);
+        return 1;
+    }
+    std::printf("%llu ops gravadas em %s (%.2f bytes/op)\n", static_cast<unsigned long long>(w.opsRecorded()),
+                caminho, static_cast<double>(w.bytesWritten()) / static_cast<double>(w.opsRecorded()));
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 4 && std::strcmp(argv[1], "--gerar") == 0) {
+        const std::size_t n = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 1000000;
+        return gerar(argv[2], argv[3], n);
+    }
+    if (argc < 2) {
+        std::printf("Uso: %s traço.bin [backend...]\n       %s --gerar tipo traço.bin [n]\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    const std::uint32_t conjunto = mascara({ TraceOp::Insert, TraceOp::Remove, TraceOp::Contains });
+    const std::uint32_t fila = mascara({ TraceOp::Enqueue, TraceOp::Dequeue });
+    const std::uint32_t pilha = mascara({ TraceOp::Push, TraceOp::Pop });
+    const Backend backends[] = {
+        { "bst", conjunto, rodarBST<BalancePolicy::None> },
+        { "scapegoat", conjunto, rodarBST<BalancePolicy::Scapegoat> },
+        { "splay", conjunto, rodarBST<BalancePolicy::Splay> },
+        { "btree", conjunto, rodar<BTree<long long>> },
+        { "hashed", conjunto, rodar<HashedBST<long long>> },
+        { "skiplist", conjunto, rodar<ConcurrentSkipList<long long>> },
+        { "set", conjunto, rodar<StdSet> },
+        { "queue", fila, rodar<Queue<long long>> },
+        { "queue-unrolled", fila, rodar<Queue<long long, UnrolledLinkedList<long long>>> },
+        { "pq", fila, rodar<PriorityQueue<long long>> },
+        { "stack", pilha, rodar<Stack<long long>> },
+        { "stack-unrolled", pilha, rodar<Stack<long long, UnrolledLinkedList<long long>>> },
+    };
+
+    std::vector<TraceRecord> traco;
+    std::size_t bytes = 0;
+    try {
+        TraceReader leitor(argv[1]);
+        traco = leitor.readAll();
+        bytes = leitor.fileBytes();
+    } catch (const std::exception& e) {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+    std::uint32_t usadas = 0;
+    for (const TraceRecord& r : traco) usadas |= 1u << static_cast<unsigned>(r.op);
+    std::printf("%s: %zu ops, %zu bytes (%.2f bytes/op)\n", argv[1], traco.size(), bytes,
+                traco.empty() ? 0.0 : static_cast<double>(bytes) / static_cast<double>(traco.size()));
+
+    bool rodou = false;
+    for (const auto& b : backends) {
+        bool pedido = argc == 2;
+        for (int i = 2; i < argc; ++i) pedido = pedido || std::strcmp(argv[i], b.nome) == 0;
+        if (!pedido) continue;
+        if ((usadas & ~b.ops) != 0) {
+            if (argc > 2) std::printf("\n[%s] não suporta todas as operações do traço\n", b.nome);
+            continue;
+        }
+        // Filas FIFO e de prioridade dão checksums diferentes por natureza
+        imprime(b.nome, b.fn(traco));
+        rodou = true;
+    }
+    if (!rodou) {
+        std::printf("Nenhum backend compatível. Disponíveis:");
+        for (const auto& b : backends) std::printf(" %s", b.nome);
+        std::printf("\n");
+        return 1;
+    }
+    return 0;
+}
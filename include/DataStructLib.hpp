@@ -1,14 +1,549 @@
 #pragma once
 #include <iostream>
 #include <vector>
+#include <array>
 #include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <exception>
+#include <functional>
+#include <utility>
+#include <type_traits>
+#include <tuple>
+#include <iterator>
+#include <cmath>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string_view>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <atomic>
+#include <thread>
+#include <cstdlib>
+#include <new>
+#include <string>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// ==================================
+// Contabilidade de memória
+// ==================================
+// Todo contêiner expõe memoryUsage(), que separa:
+//  - payloadBytes:   bytes dos próprios elementos (incluindo o heap que eles
+//                    mantêm, como o buffer de uma std::string);
+//  - overheadBytes:  ponteiros, contadores, padding e capacidade ociosa;
+//  - allocatorBytes: o que o alocador reserva para os blocos do contêiner
+//                    e dos elementos (cabeçalhos e arredondamento).
+// memoryUsage() calcula esses números a partir dos blocos que o contêiner
+// sabe ter, sem alocar nada: allocatorBytes é a regra de arredondamento do
+// malloc aplicada a cada bloco, não uma medida. A medida real dos blocos
+// vivos e a fragmentação do heap vêm de AllocationCounter e heapStats(),
+// mais abaixo.
+
+// Quanto o alocador reserva para um pedido de n bytes: cabeçalho de um
+// size_t, alinhamento de 16 e bloco mínimo de 4 size_t. É a regra da glibc
+// para blocos das arenas (blocos grandes, servidos por mmap, arredondam
+// para páginas e ficam subestimados); nos demais alocadores, uma estimativa.
+inline std::size_t allocatorBlockBytes(std::size_t n) {
+    const std::size_t bruto = n + sizeof(std::size_t);
+    const std::size_t arred = (bruto + 15) / 16 * 16;
+    const std::size_t minimo = 4 * sizeof(std::size_t);
+    return arred < minimo ? minimo : arred;
+}
+
+struct MemoryUsage {
+    std::size_t payloadBytes = 0;
+    std::size_t overheadBytes = 0;
+    std::size_t allocatorBytes = 0;
+    std::size_t allocations = 0;
+
+    // Registra `count` blocos de heap de n bytes cada
+    void addBlock(std::size_t n, std::size_t count = 1) {
+        allocatorBytes += count * allocatorBlockBytes(n);
+        allocations += count;
+    }
+
+    std::size_t totalBytes() const { return payloadBytes + overheadBytes; }
+
+    MemoryUsage& operator+=(const MemoryUsage& o) {
+        payloadBytes += o.payloadBytes;
+        overheadBytes += o.overheadBytes;
+        allocatorBytes += o.allocatorBytes;
+        allocations += o.allocations;
+        return *this;
+    }
+};
+
+// Conta os bytes de um elemento. Sobrecarregue para tipos que guardam
+// dados no heap (as versões para std::string, std::vector e std::pair
+// estão abaixo; a de PrioritizedElement fica junto da classe).
+template <typename T>
+void accountPayload(const T&, MemoryUsage& m) {
+    m.payloadBytes += sizeof(T);
+}
+
+inline void accountPayload(const std::string& s, MemoryUsage& m) {
+    m.payloadBytes += sizeof(std::string);
+    const char* d = s.data();
+    const char* obj = reinterpret_cast<const char*>(&s);
+    if (d < obj || d >= obj + sizeof(std::string)) { // fora do buffer interno (SSO)
+        m.payloadBytes += s.size() + 1;
+        m.overheadBytes += s.capacity() - s.size();
+        m.addBlock(s.capacity() + 1);
+    }
+}
+
+template <typename A, typename B>
+void accountPayload(const std::pair<A, B>& p, MemoryUsage& m) {
+    accountPayload(p.first, m);
+    accountPayload(p.second, m);
+    m.overheadBytes += sizeof(std::pair<A, B>) - sizeof(A) - sizeof(B);
+}
+
+template <typename T>
+void accountPayload(const std::vector<T>& v, MemoryUsage& m) {
+    m.overheadBytes += sizeof(std::vector<T>) + (v.capacity() - v.size()) * sizeof(T);
+    for (const T& x : v) accountPayload(x, m);
+    if (v.capacity() > 0) m.addBlock(v.capacity() * sizeof(T));
+}
+
+// Soma o payload de elementos cujo tamanho não depende do valor sem
+// percorrê-los; os demais são visitados um a um
+template <typename T, typename Visit>
+void accountElements(std::size_t n, MemoryUsage& m, Visit visit) {
+    if (std::is_arithmetic<T>::value || std::is_pointer<T>::value || std::is_enum<T>::value) {
+        m.payloadBytes += n * sizeof(T);
+    } else {
+        visit();
+    }
+}
+
+// ==================================
+// Contagem de alocações (AllocationCounter)
+// ==================================
+// Os contêineres pedem memória para nós e buffers por countedAllocate /
+// countedDeallocate: direto, pelo operator new de CountedAllocation (base
+// vazia dos nós) ou por CountingAllocator<T> (vetores e blocos). Com um
+// AllocationCounter instalado, cada bloco vivo soma ali o tamanho pedido
+// e o que o alocador de fato reservou para ele (na glibc, lido do próprio
+// malloc com malloc_usable_size). É a medida real, que memoryUsage() só
+// calcula. Sem contador instalado o custo é um load atômico por bloco.
+//
+// Instale o contador antes de criar os contêineres a medir e mantenha-o
+// até destruí-los: um bloco liberado desconta do contador instalado no
+// momento da liberação. Memória que os próprios elementos alocam (o buffer
+// de uma std::string, por exemplo) não passa por aqui, e nós removidos de
+// um ConcurrentSkipList continuam vivos até o domínio de épocas liberá-los.
+
+struct AllocationCounter {
+    std::atomic<std::size_t> liveBlocks{ 0 };
+    std::atomic<std::size_t> requestedBytes{ 0 };      // vivos, como pedidos
+    std::atomic<std::size_t> allocatorBytes{ 0 };      // vivos, como reservados pelo alocador
+    std::atomic<std::size_t> peakAllocatorBytes{ 0 };
+    std::atomic<std::size_t> allocations{ 0 };         // chamadas desde a instalação
+    std::atomic<std::size_t> deallocations{ 0 };
+};
+
+inline std::atomic<AllocationCounter*>& allocationCounterSlot() {
+    static std::atomic<AllocationCounter*> atual{ nullptr };
+    return atual;
+}
+
+// Instala c (nullptr desliga) e devolve o anterior
+inline AllocationCounter* setAllocationCounter(AllocationCounter* c) {
+    return allocationCounterSlot().exchange(c);
+}
+
+// Bytes reservados para o bloco p, pedido com n bytes
+inline std::size_t allocatorUsableBytes(const void* p, std::size_t n) {
+#if defined(__GLIBC__)
+    (void)n;
+    return malloc_usable_size(const_cast<void*>(p)) + sizeof(std::size_t);
+#else
+    (void)p;
+    return allocatorBlockBytes(n);
+#endif
+}
+
+inline void countAllocation(const void* p, std::size_t n) {
+    AllocationCounter* c = allocationCounterSlot().load(std::memory_order_acquire);
+    if (!c) return;
+    const std::size_t reservado = allocatorUsableBytes(p, n);
+    c->liveBlocks.fetch_add(1, std::memory_order_relaxed);
+    c->requestedBytes.fetch_add(n, std::memory_order_relaxed);
+    const std::size_t total = c->allocatorBytes.fetch_add(reservado, std::memory_order_relaxed) + reservado;
+    std::size_t pico = c->peakAllocatorBytes.load(std::memory_order_relaxed);
+    while (total > pico && !c->peakAllocatorBytes.compare_exchange_weak(pico, total, std::memory_order_relaxed)) {}
+    c->allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void countDeallocation(const void* p, std::size_t n) {
+    AllocationCounter* c = allocationCounterSlot().load(std::memory_order_acquire);
+    if (!c) return;
+    c->liveBlocks.fetch_sub(1, std::memory_order_relaxed);
+    c->requestedBytes.fetch_sub(n, std::memory_order_relaxed);
+    c->allocatorBytes.fetch_sub(allocatorUsableBytes(p, n), std::memory_order_relaxed);
+    c->deallocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void* countedAllocate(std::size_t n) {
+    void* p = ::operator new(n);
+    countAllocation(p, n);
+    return p;
+}
+
+inline void countedDeallocate(void* p, std::size_t n) {
+    if (!p) return;
+    countDeallocation(p, n);
+    ::operator delete(p);
+}
+
+inline void* countedAllocate(std::size_t n, std::align_val_t a) {
+    void* p = ::operator new(n, a);
+    countAllocation(p, n);
+    return p;
+}
+
+inline void countedDeallocate(void* p, std::size_t n, std::align_val_t a) {
+    if (!p) return;
+    countDeallocation(p, n);
+    ::operator delete(p, a);
+}
+
+// Base vazia: `new No(...)` e `delete no` passam pelo contador
+struct CountedAllocation {
+    static void* operator new(std::size_t n) { return countedAllocate(n); }
+    static void operator delete(void* p, std::size_t n) { countedDeallocate(p, n); }
+    static void* operator new(std::size_t n, std::align_val_t a) { return countedAllocate(n, a); }
+    static void operator delete(void* p, std::size_t n, std::align_val_t a) { countedDeallocate(p, n, a); }
+    // O operator new acima esconderia o de posicionamento global
+    static void* operator new(std::size_t, void* p) noexcept { return p; }
+    static void operator delete(void*, void*) noexcept {}
+};
+
+// Alocador padrão para std::vector, std::allocate_shared etc.
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() noexcept = default;
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        if (n > std::size_t(-1) / sizeof(T)) throw std::bad_array_new_length();
+        if (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            return static_cast<T*>(countedAllocate(n * sizeof(T), std::align_val_t(alignof(T))));
+        return static_cast<T*>(countedAllocate(n * sizeof(T)));
+    }
+    void deallocate(T* p, std::size_t n) noexcept {
+        if (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            countedDeallocate(p, n * sizeof(T), std::align_val_t(alignof(T)));
+        else
+            countedDeallocate(p, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const CountingAllocator<U>&) const noexcept { return false; }
+};
+
+// Estado do heap do processo inteiro (glibc; zeros nos demais). freeBytes
+// é memória já obtida do sistema mas livre dentro das arenas: a
+// fragmentação que os blocos vivos deixam para trás.
+struct HeapStats {
+    std::size_t arenaBytes = 0;   // obtidos do sistema (arenas + mmap)
+    std::size_t inUseBytes = 0;   // em blocos vivos
+    std::size_t freeBytes = 0;    // livres dentro das arenas
+
+    double fragmentation() const {
+        return arenaBytes ? static_cast<double>(freeBytes) / static_cast<double>(arenaBytes) : 0.0;
+    }
+};
+
+inline HeapStats heapStats() {
+    HeapStats h;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    const struct mallinfo2 mi = mallinfo2();
+    h.arenaBytes = mi.arena + mi.hblkhd;
+    h.inUseBytes = mi.uordblks + mi.hblkhd;
+    h.freeBytes = mi.fordblks;
+#endif
+    return h;
+}
+
+// ==================================
+// Formatação em lote (FormatBuffer)
+// ==================================
+// As funções de impressão e os operator<< escrevem num buffer de bytes
+// reaproveitável em vez de passar cada elemento pelo iostream. Inteiros e
+// pontos flutuantes são formatados com std::to_chars e o buffer segue para
+// o destino (descritor, std::string ou std::ostream) em blocos grandes.
+// Tipos sem caminho rápido passam por um std::ostringstream.
+
+// Como uma sequência de elementos é escrita
+struct FormatOptions {
+    const char* separator = " ";
+    std::size_t limit = std::size_t(-1);  // elementos escritos; o resto vira `ellipsis`
+    const char* ellipsis = "...";
+    bool trailingSeparator = false;       // separador também depois do último
+
+    // Formato histórico de imprimeLista/printStack: "1 2 3 "
+    static FormatOptions classic() {
+        FormatOptions o;
+        o.trailingSeparator = true;
+        return o;
+    }
+};
+
+inline long long writeToFd(int fd, const char* p, std::size_t n) {
+#if defined(_WIN32)
+    return _write(fd, p, static_cast<unsigned>(n < (1u << 30) ? n : (1u << 30)));
+#else
+    return ::write(fd, p, n);
+#endif
+}
+
+class FormatBuffer {
+public:
+    static constexpr std::size_t kDefaultChunk = std::size_t(1) << 16;
+
+    // O buffer é despejado no destino a cada `chunk` bytes e no destrutor
+    explicit FormatBuffer(int fd, std::size_t chunk = kDefaultChunk) : fd_(fd) { init(chunk); }
+    explicit FormatBuffer(std::string& destino, std::size_t chunk = kDefaultChunk) : str_(&destino) { init(chunk); }
+    // Herda a precisão do stream; os demais manipuladores (hex, fixed,
+    // setw...) não se aplicam aqui
+    explicit FormatBuffer(std::ostream& os, std::size_t chunk = kDefaultChunk)
+        : os_(&os), precision_(static_cast<int>(os.precision())) { init(chunk); }
+
+    ~FormatBuffer() { flush(); }
+
+    FormatBuffer(const FormatBuffer&) = delete;
+    FormatBuffer& operator=(const FormatBuffer&) = delete;
+
+    // Algarismos significativos dos pontos flutuantes (6, como o iostream);
+    // negativo usa a menor representação que relê o mesmo valor
+    void setPrecision(int p) { precision_ = p; }
+    int precision() const { return precision_; }
+
+    FormatBuffer& append(const char* s, std::size_t n) {
+        if (n > cap_ - len_) {
+            flush();
+            if (n > cap_) { // não cabe: vai direto, sem cópia
+                emit(s, n);
+                return *this;
+            }
+        }
+        std::memcpy(buf_.get() + len_, s, n);
+        len_ += n;
+        return *this;
+    }
+
+    FormatBuffer& put(char c) {
+        if (len_ == cap_) flush();
+        buf_[len_++] = c;
+        return *this;
+    }
+
+    template <typename U>
+    FormatBuffer& operator<<(const U& x) {
+        using V = std::decay_t<U>;
+        if constexpr (std::is_same<V, bool>::value) {
+            return put(x ? '1' : '0');
+        } else if constexpr (std::is_same<V, char>::value || std::is_same<V, signed char>::value ||
+                             std::is_same<V, unsigned char>::value) {
+            return put(static_cast<char>(x));
+        } else if constexpr (std::is_integral<V>::value) {
+            char* p = reserve(kMaxNumber);
+            len_ = static_cast<std::size_t>(std::to_chars(p, buf_.get() + cap_, x).ptr - buf_.get());
+            return *this;
+        } else if constexpr (std::is_floating_point<V>::value) {
+#if defined(__cpp_lib_to_chars)
+            char* p = reserve(kMaxNumber);
+            const std::to_chars_result r = precision_ < 0
+                ? std::to_chars(p, buf_.get() + cap_, x)
+                : std::to_chars(p, buf_.get() + cap_, x, std::chars_format::general, precision_);
+            if (r.ec == std::errc()) {
+                len_ = static_cast<std::size_t>(r.ptr - buf_.get());
+                return *this;
+            }
+#endif
+            return viaStream(x);
+        } else if constexpr (std::is_convertible<const U&, std::string_view>::value) {
+            const std::string_view s(x);
+            return append(s.data(), s.size());
+        } else {
+            return viaStream(x);
+        }
+    }
+
+    // Despeja o que estiver no buffer
+    void flush() {
+        if (len_ == 0) return;
+        emit(buf_.get(), len_);
+        len_ = 0;
+    }
+
+    bool ok() const { return ok_; }
+    std::size_t bytesWritten() const { return escritos_ + len_; }
+
+private:
+    static constexpr std::size_t kMaxNumber = 128; // qualquer inteiro ou double com precisão usual
+
+    std::unique_ptr<char[]> buf_;
+    std::size_t cap_ = 0;
+    std::size_t len_ = 0;
+    std::size_t escritos_ = 0;
+    int fd_ = -1;
+    std::string* str_ = nullptr;
+    std::ostream* os_ = nullptr;
+    int precision_ = 6;
+    bool ok_ = true;
+
+    void init(std::size_t chunk) {
+        cap_ = chunk < kMaxNumber ? kMaxNumber : chunk;
+        buf_.reset(new char[cap_]);
+    }
+
+    // Garante n bytes livres e devolve onde escrever
+    char* reserve(std::size_t n) {
+        if (cap_ - len_ < n) flush();
+        return buf_.get() + len_;
+    }
+
+    template <typename U>
+    FormatBuffer& viaStream(const U& x) {
+        thread_local std::ostringstream tmp;
+        tmp.str(std::string());
+        tmp.clear();
+        tmp.precision(precision_ < 0 ? std::numeric_limits<long double>::max_digits10 : precision_);
+        tmp << x;
+        const std::string s = tmp.str();
+        return append(s.data(), s.size());
+    }
+
+    void emit(const char* p, std::size_t n) {
+        escritos_ += n;
+        if (str_) {
+            str_->append(p, n);
+        } else if (os_) {
+            if (!os_->write(p, static_cast<std::streamsize>(n))) ok_ = false;
+        } else {
+            while (n > 0) {
+                const long long r = writeToFd(fd_, p, n);
+                if (r < 0 && errno == EINTR) continue;
+                if (r <= 0) { ok_ = false; return; }
+                p += r;
+                n -= static_cast<std::size_t>(r);
+            }
+        }
+    }
+};
+
+// Com manipuladores no stream (hex, fixed, setw...) cada elemento passa
+// pelo próprio os; no caso comum a lista é formatada em lote
+inline bool streamIsPlain(const std::ostream& os) {
+    return os.flags() == (std::ios_base::dec | std::ios_base::skipws) && os.width() == 0;
+}
+
+// Escreve o elemento de índice i de uma sequência com os separadores de opt
+template <typename U>
+void formatItem(FormatBuffer& out, std::size_t i, const U& x, const FormatOptions& opt) {
+    if (i > 0 && !opt.trailingSeparator) out << opt.separator;
+    out << x;
+    if (opt.trailingSeparator) out << opt.separator;
+}
+
+template <typename It>
+void formatRange(FormatBuffer& out, It first, It last, const FormatOptions& opt = FormatOptions()) {
+    for (std::size_t i = 0; first != last; ++first, ++i) {
+        if (i == opt.limit) {
+            formatItem(out, i, opt.ellipsis, opt);
+            return;
+        }
+        formatItem(out, i, *first, opt);
+    }
+}
+
+// Faixas a partir deste tamanho são formatadas em paralelo
+constexpr std::size_t kFormatParallelMin = std::size_t(1) << 16;
+
+// Como formatRange, mas divide a faixa em pedaços contíguos formatados
+// por threads diferentes, cada um numa std::string própria, e depois os
+// concatena em out na ordem. Percorrer a faixa para achar os cortes custa
+// bem menos que formatar, então listas encadeadas também ganham.
+template <typename It>
+void formatParallel(FormatBuffer& out, It first, It last, const FormatOptions& opt = FormatOptions(),
+                    unsigned threads = 0) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    std::size_t n = 0;
+    It fim = first;
+    while (fim != last && n < opt.limit) { ++fim; ++n; }
+    // Pedaços de pelo menos kFormatParallelMin / 4 elementos
+    std::size_t partes = n / (kFormatParallelMin / 4);
+    if (partes > threads) partes = threads;
+    if (n < kFormatParallelMin || partes <= 1) {
+        formatRange(out, first, last, opt);
+        return;
+    }
+
+    const std::size_t passo = (n + partes - 1) / partes;
+    std::vector<It> inicios;
+    inicios.reserve(partes);
+    It it = first;
+    for (std::size_t i = 0; i < n; ++i, ++it)
+        if (i % passo == 0) inicios.push_back(it);
+    partes = inicios.size();
+
+    std::vector<std::string> pedacos(partes);
+    std::vector<std::exception_ptr> erros(partes);
+    auto formata = [&](std::size_t p) {
+        try {
+            FormatBuffer b(pedacos[p]);
+            b.setPrecision(out.precision());
+            const std::size_t ini = p * passo;
+            const std::size_t fimP = ini + passo < n ? ini + passo : n;
+            It x = inicios[p];
+            for (std::size_t i = ini; i < fimP; ++i, ++x) formatItem(b, i, *x, opt);
+        } catch (...) {
+            erros[p] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> ts;
+    for (std::size_t p = 1; p < partes; ++p) ts.emplace_back(formata, p);
+    formata(0);
+    for (auto& t : ts) t.join();
+    for (const std::exception_ptr& e : erros)
+        if (e) std::rethrow_exception(e);
+
+    for (const std::string& s : pedacos) out.append(s.data(), s.size());
+    if (fim != last) formatItem(out, n, opt.ellipsis, opt);
+}
 
 // ========================
 // Classe Node (Nó da Lista)
 // ========================
 
 template <typename T>
-class Node{
+class Node : public CountedAllocation {
 private:
     T info;
     Node *link;
@@ -19,6 +554,11 @@ public:
         return info;
     }
 
+    // Retorna uma referência ao valor (evita a cópia em comparações)
+    const T& getInfoRef() const {
+        return info;
+    }
+
     // Define um novo valor para o nó
     void setInfo(T info_) {
         info = info_;
@@ -104,32 +644,440 @@ public:
 
     // Imprime todos os elementos da lista
     void imprimeLista() const {
-        Node<T>* p = inicio;
-        std::cout << "\nItens da lista: ";
-        if (p == nullptr) {
-            std::cout << "(vazia)";
+        if (!streamIsPlain(std::cout)) {
+            std::cout << "\nItens da lista: ";
+            if (inicio == nullptr) std::cout << "(vazia)";
+            for (const T& x : *this) std::cout << x << " ";
+            std::cout << "\n";
+            return;
         }
-        while (p != nullptr) {
-            std::cout << p->getInfo() << " ";
-            p = p->getLink(); // Avança para o próximo
+        FormatBuffer out(std::cout);
+        imprimeLista(out, FormatOptions::classic());
+    }
+
+    // Escreve a lista em out (fd, string ou stream) com separador e limite
+    void imprimeLista(FormatBuffer& out, const FormatOptions& opt = FormatOptions()) const {
+        out << "\nItens da lista: ";
+        if (inicio == nullptr) {
+            out << "(vazia)";
         }
-        std::cout << "\n";
+        formatRange(out, begin(), end(), opt);
+        out << '\n';
     }
 
+    // Iterador de avanço sobre os valores (somente leitura)
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        explicit const_iterator(const Node<T>* p = nullptr) : p_(p) {}
+        reference operator*() const { return p_->getInfoRef(); }
+        pointer operator->() const { return &p_->getInfoRef(); }
+        const_iterator& operator++() { p_ = p_->getLink(); return *this; }
+        const_iterator operator++(int) { const_iterator c = *this; ++*this; return c; }
+        bool operator==(const const_iterator& o) const { return p_ == o.p_; }
+        bool operator!=(const const_iterator& o) const { return p_ != o.p_; }
+
+    private:
+        const Node<T>* p_;
+    };
+
+    const_iterator begin() const { return const_iterator(inicio); }
+    const_iterator end() const { return const_iterator(); }
+
     // Retorna true se a lista estiver vazia
     bool isEmpty() const {
         return inicio == nullptr;
     }
+
+    // Memória ocupada pela lista (um bloco de heap por nó)
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m;
+        std::size_t nos = 0;
+        for (Node<T>* p = inicio; p != nullptr; p = p->getLink()) {
+            accountPayload(p->getInfoRef(), m);
+            ++nos;
+        }
+        m.overheadBytes += sizeof(LinkedList) + nos * (sizeof(Node<T>) - sizeof(T));
+        m.addBlock(sizeof(Node<T>), nos);
+        return m;
+    }
+
+    // Ordena a lista com merge sort bottom-up: estável, sem recursão e sem
+    // alocar nada, apenas religando os nós. O(n log n).
+    template <typename Cmp = std::less<T>>
+    void sort(Cmp cmp = Cmp()) {
+        if (inicio == nullptr || inicio->getLink() == nullptr) return;
+        for (std::size_t largura = 1; ; largura *= 2) {
+            Node<T>* resto = inicio;
+            Node<T>* novoInicio = nullptr;
+            Node<T>* cauda = nullptr;
+            std::size_t fusoes = 0;
+            while (resto != nullptr) {
+                Node<T>* a = resto;
+                Node<T>* b = cut(a, largura);
+                resto = cut(b, largura);
+                Node<T>* fimRun = nullptr;
+                Node<T>* run = mergeRuns(a, b, cmp, fimRun);
+                if (cauda == nullptr) novoInicio = run;
+                else cauda->setLink(run);
+                cauda = fimRun;
+                ++fusoes;
+            }
+            inicio = novoInicio;
+            if (fusoes <= 1) break;
+        }
+    }
+
+    // Move todos os nós de `other` para logo depois de `pos` (ou para o
+    // início, se pos for nullptr). Nenhum nó é realocado; `other` fica vazia.
+    // O(tamanho de other), gasto para achar o último nó dela.
+    void splice(Node<T>* pos, LinkedList& other) {
+        if (&other == this || other.inicio == nullptr) return;
+        Node<T>* ultimo = other.inicio;
+        while (ultimo->getLink() != nullptr) ultimo = ultimo->getLink();
+        if (pos == nullptr) {
+            ultimo->setLink(inicio);
+            inicio = other.inicio;
+        } else {
+            ultimo->setLink(pos->getLink());
+            pos->setLink(other.inicio);
+        }
+        other.inicio = nullptr;
+    }
+
+    // Intercala `other` (já ordenada por cmp) nesta lista (também ordenada),
+    // religando os nós em O(n + m). Em empates os nós desta lista vêm antes.
+    template <typename Cmp = std::less<T>>
+    void merge(LinkedList& other, Cmp cmp = Cmp()) {
+        if (&other == this) return;
+        Node<T>* fim = nullptr;
+        inicio = mergeRuns(inicio, other.inicio, cmp, fim);
+        other.inicio = nullptr;
+    }
+
+private:
+    // Corta a sequência após n nós e retorna o restante
+    static Node<T>* cut(Node<T>* p, std::size_t n) {
+        for (std::size_t i = 1; p != nullptr && i < n; ++i) p = p->getLink();
+        if (p == nullptr) return nullptr;
+        Node<T>* resto = p->getLink();
+        p->setLink(nullptr);
+        return resto;
+    }
+
+    // Intercala duas sequências ordenadas; `fim` recebe o último nó
+    template <typename Cmp>
+    static Node<T>* mergeRuns(Node<T>* a, Node<T>* b, Cmp& cmp, Node<T>*& fim) {
+        Node<T>* cabeca = nullptr;
+        Node<T>* cauda = nullptr;
+        while (a != nullptr && b != nullptr) {
+            Node<T>* escolhido;
+            if (cmp(b->getInfoRef(), a->getInfoRef())) { escolhido = b; b = b->getLink(); }
+            else { escolhido = a; a = a->getLink(); }
+            if (cauda == nullptr) cabeca = escolhido;
+            else cauda->setLink(escolhido);
+            cauda = escolhido;
+        }
+        Node<T>* resto = (a != nullptr) ? a : b;
+        if (cauda == nullptr) cabeca = resto;
+        else cauda->setLink(resto);
+        if (resto != nullptr) {
+            while (resto->getLink() != nullptr) resto = resto->getLink();
+            cauda = resto;
+        }
+        fim = cauda;
+        return cabeca;
+    }
+};
+
+// ===================================================
+// Classe UnrolledLinkedList (Lista encadeada desenrolada)
+// ===================================================
+// Cada nó (bloco) guarda um pequeno vetor de elementos em vez de um só, de
+// modo que percorrer a lista custa uma falta de cache por bloco e não por
+// elemento. O bloco ocupa cerca de duas linhas de cache (128 bytes).
+
+template <typename T>
+constexpr std::size_t unrolledCapacity() {
+    return sizeof(T) * 4 >= 112 ? 4 : 112 / sizeof(T);
+}
+
+template <typename T, std::size_t Cap = unrolledCapacity<T>()>
+class UnrolledLinkedList {
+    static_assert(Cap >= 2, "o bloco precisa de pelo menos 2 elementos");
+
+private:
+    // Os elementos válidos do bloco ficam em [ini, fim)
+    struct Chunk : CountedAllocation {
+        Chunk* link;
+        std::size_t ini;
+        std::size_t fim;
+        alignas(T) unsigned char dados[Cap * sizeof(T)];
+
+        Chunk(std::size_t ini_) : link(nullptr), ini(ini_), fim(ini_) {}
+
+        T* at(std::size_t i) { return reinterpret_cast<T*>(dados) + i; }
+        const T* at(std::size_t i) const { return reinterpret_cast<const T*>(dados) + i; }
+        std::size_t count() const { return fim - ini; }
+
+        // Move os elementos para o começo do bloco (abre espaço no fim)
+        void compact() {
+            if (ini == 0) return;
+            for (std::size_t i = ini; i < fim; ++i) {
+                new (at(i - ini)) T(std::move(*at(i)));
+                at(i)->~T();
+            }
+            fim -= ini;
+            ini = 0;
+        }
+    };
+
+    Chunk* inicio; // primeiro bloco
+    Chunk* fimLista; // último bloco (insertEnd em O(1))
+    std::size_t sz;
+
+public:
+    UnrolledLinkedList() : inicio(nullptr), fimLista(nullptr), sz(0) {}
+
+    ~UnrolledLinkedList() { clear(); }
+
+    UnrolledLinkedList(const UnrolledLinkedList&) = delete;
+    UnrolledLinkedList& operator=(const UnrolledLinkedList&) = delete;
+
+    void clear() {
+        Chunk* c = inicio;
+        while (c) {
+            Chunk* prox = c->link;
+            for (std::size_t i = c->ini; i < c->fim; ++i) c->at(i)->~T();
+            delete c;
+            c = prox;
+        }
+        inicio = fimLista = nullptr;
+        sz = 0;
+    }
+
+    std::size_t size() const { return sz; }
+
+    bool isEmpty() const { return sz == 0; }
+
+    // Memória ocupada: um bloco de heap por Chunk; posições vazias dos
+    // blocos contam como overhead
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m;
+        std::size_t blocos = 0;
+        for (const Chunk* c = inicio; c != nullptr; c = c->link) ++blocos;
+        accountElements<T>(sz, m, [&] { for (const T& x : *this) accountPayload(x, m); });
+        m.overheadBytes += sizeof(UnrolledLinkedList) + blocos * sizeof(Chunk) - sz * sizeof(T);
+        m.addBlock(sizeof(Chunk), blocos);
+        return m;
+    }
+
+    // Insere no início; um bloco novo é preenchido de trás para frente
+    void insertStart(T x) {
+        if (!inicio || inicio->ini == 0) {
+            Chunk* c = new Chunk(Cap);
+            c->link = inicio;
+            inicio = c;
+            if (!fimLista) fimLista = c;
+        }
+        new (inicio->at(inicio->ini - 1)) T(std::move(x));
+        --inicio->ini;
+        ++sz;
+    }
+
+    // Insere no final
+    void insertEnd(T x) {
+        if (!fimLista || fimLista->fim == Cap) {
+            Chunk* c = new Chunk(0);
+            if (fimLista) fimLista->link = c;
+            else inicio = c;
+            fimLista = c;
+        }
+        new (fimLista->at(fimLista->fim)) T(std::move(x));
+        ++fimLista->fim;
+        ++sz;
+    }
+
+    // Remove e retorna o primeiro elemento
+    T removeStart() {
+        if (sz == 0) throw std::runtime_error("Lista vazia");
+        T info = std::move(*inicio->at(inicio->ini));
+        inicio->at(inicio->ini)->~T();
+        ++inicio->ini;
+        --sz;
+        if (inicio->ini == inicio->fim) unlink(nullptr, inicio);
+        return info;
+    }
+
+    // Insere x na posição pos (0..size). Um bloco cheio é dividido ao meio.
+    void insertAt(std::size_t pos, T x) {
+        if (pos > sz) throw std::out_of_range("Posição inválida");
+        if (pos == 0) { insertStart(std::move(x)); return; }
+        if (pos == sz) { insertEnd(std::move(x)); return; }
+
+        Chunk* ant = nullptr;
+        Chunk* c = locate(pos, ant);
+        if (c->count() == Cap) {
+            splitChunk(c);
+            if (pos > c->count()) { pos -= c->count(); c = c->link; }
+        }
+        if (c->fim == Cap) c->compact();
+        // Abre espaço deslocando [pos, fim) uma posição para a direita
+        const std::size_t alvo = c->ini + pos;
+        if (alvo == c->fim) {
+            new (c->at(alvo)) T(std::move(x));
+        } else {
+            new (c->at(c->fim)) T(std::move(*c->at(c->fim - 1)));
+            for (std::size_t i = c->fim - 1; i > alvo; --i) *c->at(i) = std::move(*c->at(i - 1));
+            *c->at(alvo) = std::move(x);
+        }
+        ++c->fim;
+        ++sz;
+    }
+
+    // Remove o elemento da posição pos. Blocos com menos da metade são
+    // fundidos com o seguinte quando cabem juntos num bloco só.
+    T removeAt(std::size_t pos) {
+        if (pos >= sz) throw std::out_of_range("Posição inválida");
+        Chunk* ant = nullptr;
+        Chunk* c = locate(pos, ant);
+        const std::size_t alvo = c->ini + pos;
+        T info = std::move(*c->at(alvo));
+        for (std::size_t i = alvo; i + 1 < c->fim; ++i) *c->at(i) = std::move(*c->at(i + 1));
+        c->at(c->fim - 1)->~T();
+        --c->fim;
+        --sz;
+
+        if (c->count() == 0) unlink(ant, c);
+        else if (c->count() < Cap / 2 && c->link && c->count() + c->link->count() <= Cap) mergeNext(c);
+        return info;
+    }
+
+    // Imprime todos os elementos da lista
+    void imprimeLista() const {
+        if (!streamIsPlain(std::cout)) {
+            std::cout << "\nItens da lista: ";
+            if (sz == 0) std::cout << "(vazia)";
+            for (const T& x : *this) std::cout << x << " ";
+            std::cout << "\n";
+            return;
+        }
+        FormatBuffer out(std::cout);
+        imprimeLista(out, FormatOptions::classic());
+    }
+
+    // Escreve a lista em out (fd, string ou stream) com separador e limite
+    void imprimeLista(FormatBuffer& out, const FormatOptions& opt = FormatOptions()) const {
+        out << "\nItens da lista: ";
+        if (sz == 0) {
+            out << "(vazia)";
+        }
+        formatRange(out, begin(), end(), opt);
+        out << '\n';
+    }
+
+    // Iterador de avanço sobre (bloco, índice)
+    template <bool Const>
+    class basic_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = typename std::conditional<Const, const T*, T*>::type;
+        using reference = typename std::conditional<Const, const T&, T&>::type;
+
+        basic_iterator() : c_(nullptr), i_(0) {}
+        reference operator*() const { return *c_->at(i_); }
+        pointer operator->() const { return c_->at(i_); }
+        basic_iterator& operator++() {
+            if (++i_ == c_->fim) {
+                c_ = c_->link;
+                i_ = c_ ? c_->ini : 0;
+            }
+            return *this;
+        }
+        basic_iterator operator++(int) { basic_iterator c = *this; ++*this; return c; }
+        bool operator==(const basic_iterator& o) const { return c_ == o.c_ && i_ == o.i_; }
+        bool operator!=(const basic_iterator& o) const { return !(*this == o); }
+
+    private:
+        friend class UnrolledLinkedList;
+        using ChunkPtr = typename std::conditional<Const, const Chunk*, Chunk*>::type;
+        basic_iterator(ChunkPtr c, std::size_t i) : c_(c), i_(i) {}
+        ChunkPtr c_;
+        std::size_t i_;
+    };
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    iterator begin() { return inicio ? iterator(inicio, inicio->ini) : iterator(); }
+    iterator end() { return iterator(); }
+    const_iterator begin() const { return inicio ? const_iterator(inicio, inicio->ini) : const_iterator(); }
+    const_iterator end() const { return const_iterator(); }
+
+private:
+    // Bloco que contém a posição pos; pos vira o índice relativo ao bloco
+    Chunk* locate(std::size_t& pos, Chunk*& ant) {
+        Chunk* c = inicio;
+        while (pos >= c->count()) {
+            pos -= c->count();
+            ant = c;
+            c = c->link;
+        }
+        return c;
+    }
+
+    void unlink(Chunk* ant, Chunk* c) {
+        if (ant) ant->link = c->link;
+        else inicio = c->link;
+        if (fimLista == c) fimLista = ant;
+        delete c;
+    }
+
+    // Move a metade superior de c para um bloco novo logo depois dele
+    void splitChunk(Chunk* c) {
+        Chunk* n = new Chunk(0);
+        const std::size_t meio = c->ini + c->count() / 2;
+        for (std::size_t i = meio; i < c->fim; ++i) {
+            new (n->at(n->fim++)) T(std::move(*c->at(i)));
+            c->at(i)->~T();
+        }
+        c->fim = meio;
+        n->link = c->link;
+        c->link = n;
+        if (fimLista == c) fimLista = n;
+    }
+
+    // Absorve o bloco seguinte em c
+    void mergeNext(Chunk* c) {
+        Chunk* n = c->link;
+        c->compact();
+        for (std::size_t i = n->ini; i < n->fim; ++i) {
+            new (c->at(c->fim++)) T(std::move(*n->at(i)));
+            n->at(i)->~T();
+        }
+        n->fim = n->ini;
+        c->link = n->link;
+        if (fimLista == n) fimLista = c;
+        delete n;
+    }
 };
 
 // =====================
 // Classe Queue (Fila)
 // =====================
+// O segundo parâmetro escolhe a lista usada por baixo: LinkedList (padrão)
+// ou UnrolledLinkedList<T>, que guarda vários elementos por nó.
 
-template <typename T>
+template <typename T, typename List = LinkedList<T>>
 class Queue {
 private:
-    LinkedList<T> queue; // Usa uma lista encadeada internamente
+    List queue; // Usa uma lista encadeada internamente
 public:
     // Adiciona no fim da fila
     void enqueue(T x) {
@@ -146,6 +1094,10 @@ public:
         queue.imprimeLista();
     }
 
+    void printQueue(FormatBuffer& out, const FormatOptions& opt = FormatOptions()) const {
+        queue.imprimeLista(out, opt);
+    }
+
     // Verifica se a fila está vazia
     bool isEmpty() const {
         return queue.isEmpty();
@@ -154,16 +1106,22 @@ public:
     Node<T>* getHead() const{
         return queue.getHead();
     }
+
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m = queue.memoryUsage();
+        m.overheadBytes += sizeof(Queue) - sizeof(List);
+        return m;
+    }
 };
 
 // =====================
 // Classe Stack (Pilha)
 // =====================
 
-template <typename T>
+template <typename T, typename List = LinkedList<T>>
 class Stack {
 private:
-    LinkedList<T> stack; // Internamente usa uma lista
+    List stack; // Internamente usa uma lista (LinkedList ou UnrolledLinkedList)
 
 public:
     // Insere no topo da pilha (início da lista)
@@ -181,27 +1139,377 @@ public:
         stack.imprimeLista();
     }
 
+    void printStack(FormatBuffer& out, const FormatOptions& opt = FormatOptions()) const {
+        stack.imprimeLista(out, opt);
+    }
+
     // Verifica se a pilha está vazia
     bool isEmpty() const {
         return stack.isEmpty();
     }
+
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m = stack.memoryUsage();
+        m.overheadBytes += sizeof(Stack) - sizeof(List);
+        return m;
+    }
 };
 
-// =================================================
-// Classe PrioritizedElement (Elemento com Prioridade)
-// =================================================
+// ==================================================
+// Classe InlineStack (Pilha contígua com buffer interno)
+// ==================================================
+// Os primeiros InlineCapacity elementos ficam dentro do próprio objeto; só
+// pilhas mais fundas que isso vão para um buffer no heap, que cresce
+// dobrando de tamanho. Pilhas rasas (avaliação de expressões, DFS) não
+// fazem nenhuma alocação.
 
-template <typename T>
-class PrioritizedElement {
+template <typename T, std::size_t InlineCapacity = 64>
+class InlineStack {
 private:
-    T value;                // Valor armazenado
-    unsigned int priority;  // Prioridade do elemento (quanto menor, maior a prioridade)
-    size_t arrivalOrder;    // Ordem de chegada (para desempatar prioridades iguais)
+    T* dados;            // aponta para o buffer interno ou para o heap
+    std::size_t tam;     // quantidade de elementos
+    std::size_t cap;     // capacidade atual
+    alignas(T) unsigned char interno[InlineCapacity * sizeof(T)];
+
+    bool usaInterno() const {
+        return dados == reinterpret_cast<const T*>(interno);
+    }
+
+    // Buffer do heap; CountingAllocator usa o new alinhado para T superalinhado
+    void grow(std::size_t minimo) {
+        std::size_t novaCap = cap * 2;
+        if (novaCap < minimo) novaCap = minimo;
+        T* novo = CountingAllocator<T>().allocate(novaCap);
+        // Os antigos só são destruídos depois que todos chegaram: se um
+        // construtor lançar, a pilha fica como estava (move_if_noexcept
+        // copia quando mover poderia lançar)
+        std::size_t i = 0;
+        try {
+            for (; i < tam; ++i) new (novo + i) T(std::move_if_noexcept(dados[i]));
+        } catch (...) {
+            while (i > 0) novo[--i].~T();
+            CountingAllocator<T>().deallocate(novo, novaCap);
+            throw;
+        }
+        for (i = 0; i < tam; ++i) dados[i].~T();
+        if (!usaInterno()) CountingAllocator<T>().deallocate(dados, cap);
+        dados = novo;
+        cap = novaCap;
+    }
 
 public:
-    // Construtor com valores
-    PrioritizedElement(T value_, unsigned int priority_, size_t arrivalOrder_)
-        : value(value_), priority(priority_), arrivalOrder(arrivalOrder_) {}
+    InlineStack()
+        : dados(reinterpret_cast<T*>(interno)), tam(0), cap(InlineCapacity) {}
+
+    ~InlineStack() {
+        clear();
+        if (!usaInterno()) CountingAllocator<T>().deallocate(dados, cap);
+    }
+
+    InlineStack(const InlineStack&) = delete;
+    InlineStack& operator=(const InlineStack&) = delete;
+
+    // Garante espaço para n elementos sem realocar
+    void reserve(std::size_t n) {
+        if (n > cap) grow(n);
+    }
+
+    // Insere no topo da pilha
+    void push(T x) {
+        if (tam == cap) grow(tam + 1);
+        new (dados + tam) T(std::move(x));
+        ++tam;
+    }
+
+    // Insere vários elementos; o último do intervalo fica no topo
+    template <typename It>
+    void pushMany(It first, It last) {
+        for (; first != last; ++first) push(*first);
+    }
+
+    // Remove do topo da pilha
+    T pop() {
+        if (tam == 0) throw std::runtime_error("Pilha vazia");
+        --tam;
+        T x = std::move(dados[tam]);
+        dados[tam].~T();
+        return x;
+    }
+
+    // Remove até n elementos, escrevendo-os em out na ordem de remoção.
+    // Retorna quantos foram removidos.
+    template <typename OutIt>
+    std::size_t popMany(std::size_t n, OutIt out) {
+        if (n > tam) n = tam;
+        for (std::size_t i = 0; i < n; ++i) {
+            --tam;
+            *out++ = std::move(dados[tam]);
+            dados[tam].~T();
+        }
+        return n;
+    }
+
+    // Acesso ao topo sem remover
+    T& top() {
+        if (tam == 0) throw std::runtime_error("Pilha vazia");
+        return dados[tam - 1];
+    }
+    const T& top() const {
+        if (tam == 0) throw std::runtime_error("Pilha vazia");
+        return dados[tam - 1];
+    }
+
+    void clear() {
+        while (tam > 0) dados[--tam].~T();
+    }
+
+    std::size_t size() const { return tam; }
+    std::size_t capacity() const { return cap; }
+
+    // Memória ocupada: o buffer interno faz parte do objeto; o buffer do
+    // heap (se houver) é um único bloco
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m;
+        accountElements<T>(tam, m, [&] { for (std::size_t i = 0; i < tam; ++i) accountPayload(dados[i], m); });
+        if (usaInterno()) {
+            m.overheadBytes += sizeof(InlineStack) - tam * sizeof(T);
+        } else {
+            m.overheadBytes += sizeof(InlineStack) + (cap - tam) * sizeof(T);
+            m.addBlock(cap * sizeof(T));
+        }
+        return m;
+    }
+
+    // Verifica se a pilha está vazia
+    bool isEmpty() const {
+        return tam == 0;
+    }
+
+    // Imprime a pilha (do topo para a base, como Stack)
+    void printStack() const {
+        if (!streamIsPlain(std::cout)) {
+            std::cout << "\nItens da lista: ";
+            if (tam == 0) std::cout << "(vazia)";
+            for (std::size_t i = tam; i-- > 0;) std::cout << dados[i] << " ";
+            std::cout << "\n";
+            return;
+        }
+        FormatBuffer out(std::cout);
+        printStack(out, FormatOptions::classic());
+    }
+
+    void printStack(FormatBuffer& out, const FormatOptions& opt = FormatOptions()) const {
+        out << "\nItens da lista: ";
+        if (tam == 0) {
+            out << "(vazia)";
+        }
+        formatRange(out, std::make_reverse_iterator(dados + tam), std::make_reverse_iterator(dados), opt);
+        out << '\n';
+    }
+};
+
+// ==================================================
+// Listas intrusivas (IntrusiveList / IntrusiveQueue)
+// ==================================================
+// Os ponteiros de ligação moram no próprio objeto (que herda ListHook), e
+// não num Node alocado pelo contêiner: inserir não aloca nem copia, e o
+// objeto pode ser desligado em O(1) de qualquer posição. O contêiner não
+// é dono dos objetos: quem os criou (pool, pilha, heap) continua
+// responsável por eles e precisa desligá-los antes de destruí-los.
+// Um objeto pode estar em várias listas ao mesmo tempo com hooks de tags
+// diferentes:
+//
+//     struct PorFila {};
+//     struct PorDono {};
+//     struct Job : ListHook<PorFila>, ListHook<PorDono> { int id; };
+//     IntrusiveList<Job, PorFila> fila;
+//     IntrusiveList<Job, PorDono> doDono;
+
+template <typename Tag = void>
+class ListHook {
+public:
+    ListHook() = default;
+    // Copiar o objeto não copia as ligações: a cópia nasce desligada
+    ListHook(const ListHook&) {}
+    ListHook& operator=(const ListHook&) { return *this; }
+
+    bool isLinked() const { return next_ != nullptr; }
+
+private:
+    template <typename T, typename G> friend class IntrusiveList;
+    ListHook* prev_ = nullptr;
+    ListHook* next_ = nullptr;
+};
+
+template <typename T, typename Tag = void>
+class IntrusiveList {
+    using Hook = ListHook<Tag>;
+
+    // Sentinela da lista circular: head_.next_ é o primeiro, head_.prev_ o último
+    Hook head_;
+    std::size_t sz_ = 0;
+
+    static Hook* hookOf(T& x) { return static_cast<Hook*>(&x); }
+    static T& objectOf(Hook* h) { return static_cast<T&>(*h); }
+
+    void linkBefore(Hook* pos, Hook* h) {
+        if (h->isLinked()) throw std::invalid_argument("Objeto já está numa lista");
+        h->prev_ = pos->prev_;
+        h->next_ = pos;
+        pos->prev_->next_ = h;
+        pos->prev_ = h;
+        ++sz_;
+    }
+
+    void unlinkHook(Hook* h) {
+        h->prev_->next_ = h->next_;
+        h->next_->prev_ = h->prev_;
+        h->prev_ = h->next_ = nullptr;
+        --sz_;
+    }
+
+public:
+    IntrusiveList() { head_.prev_ = head_.next_ = &head_; }
+    ~IntrusiveList() { clear(); }
+
+    IntrusiveList(const IntrusiveList&) = delete;
+    IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+    template <bool Const>
+    class basic_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using reference = std::conditional_t<Const, const T&, T&>;
+
+        basic_iterator() : h_(nullptr) {}
+        // iterator -> const_iterator
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        basic_iterator(const basic_iterator<false>& o) : h_(o.h_) {}
+
+        reference operator*() const { return objectOf(const_cast<Hook*>(h_)); }
+        pointer operator->() const { return &**this; }
+        basic_iterator& operator++() { h_ = h_->next_; return *this; }
+        basic_iterator operator++(int) { basic_iterator c = *this; ++*this; return c; }
+        basic_iterator& operator--() { h_ = h_->prev_; return *this; }
+        basic_iterator operator--(int) { basic_iterator c = *this; --*this; return c; }
+        bool operator==(const basic_iterator& o) const { return h_ == o.h_; }
+        bool operator!=(const basic_iterator& o) const { return h_ != o.h_; }
+
+    private:
+        friend class IntrusiveList;
+        template <bool> friend class basic_iterator;
+        explicit basic_iterator(const Hook* h) : h_(h) {}
+        const Hook* h_;
+    };
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    iterator begin() { return iterator(head_.next_); }
+    iterator end() { return iterator(&head_); }
+    const_iterator begin() const { return const_iterator(head_.next_); }
+    const_iterator end() const { return const_iterator(&head_); }
+
+    // Iterador para um objeto que está nesta lista
+    iterator iteratorTo(T& x) { return iterator(hookOf(x)); }
+
+    std::size_t size() const { return sz_; }
+    bool isEmpty() const { return sz_ == 0; }
+
+    T& front() {
+        if (sz_ == 0) throw std::runtime_error("Lista vazia");
+        return objectOf(head_.next_);
+    }
+    T& back() {
+        if (sz_ == 0) throw std::runtime_error("Lista vazia");
+        return objectOf(head_.prev_);
+    }
+
+    void insertStart(T& x) { linkBefore(head_.next_, hookOf(x)); }
+    void insertEnd(T& x) { linkBefore(&head_, hookOf(x)); }
+    // Insere x antes de pos
+    void insertBefore(iterator pos, T& x) { linkBefore(const_cast<Hook*>(pos.h_), hookOf(x)); }
+
+    T& removeStart() {
+        T& x = front();
+        unlinkHook(head_.next_);
+        return x;
+    }
+    T& removeEnd() {
+        T& x = back();
+        unlinkHook(head_.prev_);
+        return x;
+    }
+
+    // Desliga x (que precisa estar nesta lista) em O(1)
+    void erase(T& x) { unlinkHook(hookOf(x)); }
+
+    // Desliga todos os objetos sem destruí-los
+    void clear() {
+        clear([](T&) {});
+    }
+
+    // Desliga todos e entrega cada objeto a `descarte` (ex.: devolver ao
+    // pool ou `delete`), já desligado
+    template <typename Disposer>
+    void clear(Disposer descarte) {
+        while (sz_ > 0) descarte(removeStart());
+    }
+
+    // Os objetos não pertencem à lista: só ela mesma conta como estrutura
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m;
+        m.overheadBytes += sizeof(IntrusiveList);
+        return m;
+    }
+};
+
+// Fila FIFO sobre IntrusiveList: enfileirar e desenfileirar sem alocação,
+// e cancelar um elemento em qualquer posição em O(1)
+template <typename T, typename Tag = void>
+class IntrusiveQueue {
+private:
+    IntrusiveList<T, Tag> list;
+
+public:
+    void enqueue(T& x) { list.insertEnd(x); }
+    T& dequeue() { return list.removeStart(); }
+    T& front() { return list.front(); }
+    void erase(T& x) { list.erase(x); }
+    bool isEmpty() const { return list.isEmpty(); }
+    std::size_t size() const { return list.size(); }
+
+    void clear() { list.clear(); }
+    template <typename Disposer>
+    void clear(Disposer descarte) { list.clear(descarte); }
+
+    typename IntrusiveList<T, Tag>::iterator begin() { return list.begin(); }
+    typename IntrusiveList<T, Tag>::iterator end() { return list.end(); }
+
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m = list.memoryUsage();
+        m.overheadBytes += sizeof(IntrusiveQueue) - sizeof(list);
+        return m;
+    }
+};
+
+// =================================================
+// Classe PrioritizedElement (Elemento com Prioridade)
+// =================================================
+
+template <typename T>
+class PrioritizedElement {
+private:
+    T value;                // Valor armazenado
+    unsigned int priority;  // Prioridade do elemento (quanto menor, maior a prioridade)
+    size_t arrivalOrder;    // Ordem de chegada (para desempatar prioridades iguais)
+
+public:
+    // Construtor com valores
+    PrioritizedElement(T value_, unsigned int priority_, size_t arrivalOrder_)
+        : value(std::move(value_)), priority(priority_), arrivalOrder(arrivalOrder_) {}
 
     // Construtor padrão
     PrioritizedElement() : value(), priority(0), arrivalOrder(0) {}
@@ -210,6 +1518,14 @@ public:
         return value;
     }
 
+    const T& getValueRef() const {
+        return value;
+    }
+
+    T& getValueRef() {
+        return value;
+    }
+
     unsigned int getPriority() const {
         return priority;
     }
@@ -217,83 +1533,278 @@ public:
     size_t getArrivalOrder() const {
         return arrivalOrder;
     }
+
+    void setPriority(unsigned int priority_) {
+        priority = priority_;
+    }
 };
 
+// Prioridade e ordem de chegada contam como dado do elemento
+template <typename T>
+void accountPayload(const PrioritizedElement<T>& e, MemoryUsage& m) {
+    accountPayload(e.getValueRef(), m);
+    m.payloadBytes += sizeof(PrioritizedElement<T>) - sizeof(T);
+}
+
 // ========================================
 // Classe PriorityQueue (Fila de Prioridade)
 // ========================================
+// Heap 4-ário indexado. enqueue devolve um Handle estável, que continua
+// válido enquanto o elemento estiver na fila (mesmo que ele mude de
+// posição no heap) e permite reprioritizar ou cancelar o elemento em
+// O(log n). Handles de elementos que já saíram são reconhecidos como
+// inválidos: cada slot tem uma geração que muda quando ele é reutilizado.
 
 template <typename T>
 class PriorityQueue {
+public:
+    class Handle {
+    public:
+        Handle() : slot(kNoSlot), gen(0) {}
+        bool operator==(const Handle& o) const { return slot == o.slot && gen == o.gen; }
+        bool operator!=(const Handle& o) const { return !(*this == o); }
+    private:
+        friend class PriorityQueue;
+        static constexpr std::uint32_t kNoSlot = ~std::uint32_t(0);
+        Handle(std::uint32_t s, std::uint32_t g) : slot(s), gen(g) {}
+        std::uint32_t slot;
+        std::uint32_t gen;
+    };
+
 private:
-    LinkedList<PrioritizedElement<T>> list; // Lista ordenada por prioridade
+    static constexpr std::size_t kAridade = 4;
+    static constexpr std::size_t kNoPos = ~std::size_t(0);
+
+    struct Entry {
+        PrioritizedElement<T> elem;
+        std::uint32_t slot; // slot que aponta de volta para esta posição
+    };
+
+    struct Slot {
+        std::size_t pos;    // posição no heap (kNoPos se livre)
+        std::uint32_t gen;
+    };
+
+    std::vector<Entry, CountingAllocator<Entry>> heap;
+    std::vector<Slot, CountingAllocator<Slot>> slots;
+    std::vector<std::uint32_t, CountingAllocator<std::uint32_t>> livres; // slots reutilizáveis
     size_t counter; // Contador de chegada para desempate
 
     size_t getCounter() const {
         return counter;
     }
 
-public:
-    PriorityQueue() : counter(0) {}
+    // Ordem da fila: menor prioridade primeiro, empate pela ordem de chegada
+    static bool comesBefore(const PrioritizedElement<T>& a, const PrioritizedElement<T>& b) {
+        if (a.getPriority() != b.getPriority()) return a.getPriority() < b.getPriority();
+        return a.getArrivalOrder() < b.getArrivalOrder();
+    }
 
-    // Insere elemento na posição correta de acordo com prioridade e chegada
-    void enqueue(T value, unsigned int priority) {
-        PrioritizedElement<T> newElement(value, priority, counter++);
+    std::uint32_t allocSlot() {
+        if (!livres.empty()) {
+            const std::uint32_t s = livres.back();
+            livres.pop_back();
+            return s;
+        }
+        slots.push_back(Slot{ kNoPos, 0 });
+        return static_cast<std::uint32_t>(slots.size() - 1);
+    }
 
-        Node<PrioritizedElement<T>>* anterior = nullptr;
-        Node<PrioritizedElement<T>>* atual = list.getHead();
+    void freeSlot(std::uint32_t s) {
+        slots[s].pos = kNoPos;
+        ++slots[s].gen;
+        livres.push_back(s);
+    }
 
-        // Percorre a lista para encontrar a posição correta
-        while (atual != nullptr){
-            auto infoAtual = atual->getInfo();
-            if (infoAtual.getPriority() < newElement.getPriority()){
-                anterior = atual;
-                atual = atual->getLink();
-            }
-            else if ((infoAtual.getPriority() == newElement.getPriority()) &&
-                     (infoAtual.getArrivalOrder() < newElement.getArrivalOrder())){
-                // Mesma prioridade, mas chegou antes
-                anterior = atual;
-                atual = atual->getLink();
-            }
-            else {
-                // Encontrou posição
-                break;
+    // Posição no heap do elemento do handle (kNoPos se inválido)
+    std::size_t positionOf(Handle h) const {
+        if (h.slot >= slots.size() || slots[h.slot].gen != h.gen) return kNoPos;
+        return slots[h.slot].pos;
+    }
+
+    void place(std::size_t i, Entry&& e) {
+        slots[e.slot].pos = i;
+        heap[i] = std::move(e);
+    }
+
+    // Sobe o elemento da posição i (buraco móvel: uma cópia por nível)
+    void siftUp(std::size_t i) {
+        Entry e = std::move(heap[i]);
+        while (i > 0) {
+            const std::size_t pai = (i - 1) / kAridade;
+            if (!comesBefore(e.elem, heap[pai].elem)) break;
+            place(i, std::move(heap[pai]));
+            i = pai;
+        }
+        place(i, std::move(e));
+    }
+
+    void siftDown(std::size_t i) {
+        const std::size_t n = heap.size();
+        Entry e = std::move(heap[i]);
+        while (true) {
+            const std::size_t primeiro = i * kAridade + 1;
+            if (primeiro >= n) break;
+            const std::size_t ultimo = std::min(primeiro + kAridade, n);
+            std::size_t melhor = primeiro;
+            for (std::size_t c = primeiro + 1; c < ultimo; ++c) {
+                if (comesBefore(heap[c].elem, heap[melhor].elem)) melhor = c;
             }
+            if (!comesBefore(heap[melhor].elem, e.elem)) break;
+            place(i, std::move(heap[melhor]));
+            i = melhor;
+        }
+        place(i, std::move(e));
+    }
+
+    // Tira o elemento da posição i, tapando o buraco com o último
+    PrioritizedElement<T> extractAt(std::size_t i) {
+        PrioritizedElement<T> saida = std::move(heap[i].elem);
+        freeSlot(heap[i].slot);
+        if (i + 1 == heap.size()) {
+            heap.pop_back();
+            return saida;
         }
+        place(i, std::move(heap.back()));
+        heap.pop_back();
+        if (i > 0 && comesBefore(heap[i].elem, heap[(i - 1) / kAridade].elem)) siftUp(i);
+        else siftDown(i);
+        return saida;
+    }
+
+public:
+    PriorityQueue() : counter(0) {}
 
-        // Cria novo nó com o elemento
-        Node<PrioritizedElement<T>>* newNode = new Node<PrioritizedElement<T>>(newElement);
+    // Insere elemento de acordo com prioridade e chegada em O(log n)
+    Handle enqueue(T value, unsigned int priority) {
+        const std::uint32_t s = allocSlot();
+        heap.push_back(Entry{ PrioritizedElement<T>(std::move(value), priority, counter++), s });
+        slots[s].pos = heap.size() - 1;
+        siftUp(heap.size() - 1);
+        return Handle(s, slots[s].gen);
+    }
 
-        if (anterior == nullptr) {
-            // Inserção no início
-            newNode->setLink(list.getHead());
-            list.setHead(newNode);
+    // Insere um lote de pares (valor, prioridade); a ordem de chegada segue
+    // a ordem do intervalo. Lotes grandes em relação à fila são anexados e
+    // o heap inteiro é refeito de baixo para cima (Floyd) em O(n + k); lotes
+    // pequenos sobem um a um, em O(k log n).
+    template <typename It>
+    void enqueueRange(It first, It last) {
+        const std::size_t antes = heap.size();
+        for (; first != last; ++first) {
+            const std::uint32_t s = allocSlot();
+            heap.push_back(Entry{ PrioritizedElement<T>(first->first, first->second, counter++), s });
+            slots[s].pos = heap.size() - 1;
+        }
+        const std::size_t k = heap.size() - antes;
+        if (k > antes / 2) {
+            if (heap.size() > 1) {
+                for (std::size_t i = (heap.size() - 2) / kAridade + 1; i-- > 0;) siftDown(i);
+            }
         } else {
-            // Inserção no meio/final
-            newNode->setLink(anterior->getLink());
-            anterior->setLink(newNode);
+            for (std::size_t i = antes; i < heap.size(); ++i) siftUp(i);
         }
     }
 
-    // Remove o elemento com maior prioridade (está no início)
+    template <typename It>
+    void enqueueAll(It first, It last) {
+        enqueueRange(first, last);
+    }
+
+    // Remove o elemento com maior prioridade (está na raiz)
     T dequeue() {
-        return list.removeStart().getValue();
+        if (heap.empty()) throw std::runtime_error("Fila vazia");
+        return std::move(extractAt(0).getValueRef());
+    }
+
+    // Acrescenta a `out` os até k elementos de maior prioridade, em ordem,
+    // e devolve quantos saíram
+    std::size_t dequeueBatch(std::size_t k, std::vector<T>& out) {
+        k = std::min(k, heap.size());
+        if (k == heap.size()) {
+            std::vector<T> tudo = drainAll();
+            out.insert(out.end(), std::make_move_iterator(tudo.begin()), std::make_move_iterator(tudo.end()));
+            return k;
+        }
+        out.reserve(out.size() + k);
+        for (std::size_t i = 0; i < k; ++i) out.push_back(std::move(extractAt(0).getValueRef()));
+        return k;
+    }
+
+    // Esvazia a fila devolvendo todos os valores em ordem de saída: uma
+    // ordenação só, em vez de n extrações do heap
+    std::vector<T> drainAll() {
+        std::sort(heap.begin(), heap.end(), [](const Entry& a, const Entry& b) {
+            return comesBefore(a.elem, b.elem);
+        });
+        std::vector<T> out;
+        out.reserve(heap.size());
+        for (Entry& e : heap) {
+            out.push_back(std::move(e.elem.getValueRef()));
+            freeSlot(e.slot);
+        }
+        heap.clear();
+        return out;
+    }
+
+    // Elemento com maior prioridade, sem removê-lo
+    const T& top() const {
+        if (heap.empty()) throw std::runtime_error("Fila vazia");
+        return heap[0].elem.getValueRef();
+    }
+
+    // O handle ainda se refere a um elemento na fila?
+    bool contains(Handle h) const {
+        return positionOf(h) != kNoPos;
+    }
+
+    // Muda a prioridade mantendo a ordem de chegada original, de modo que
+    // entre prioridades iguais o elemento não "fura" nem perde a vez
+    void updatePriority(Handle h, unsigned int priority) {
+        const std::size_t i = positionOf(h);
+        if (i == kNoPos) throw std::invalid_argument("Handle inválido");
+        const unsigned int antiga = heap[i].elem.getPriority();
+        heap[i].elem.setPriority(priority);
+        if (priority < antiga) siftUp(i);
+        else if (priority > antiga) siftDown(i);
+    }
+
+    // Cancela o elemento do handle e devolve seu valor
+    T remove(Handle h) {
+        const std::size_t i = positionOf(h);
+        if (i == kNoPos) throw std::invalid_argument("Handle inválido");
+        return std::move(extractAt(i).getValueRef());
     }
 
     // Verifica se a fila está vazia
     bool isEmpty() const{
-        return list.isEmpty();
+        return heap.empty();
     }
 
-    // Retorna um std::vector com todos os elementos
+    std::size_t size() const {
+        return heap.size();
+    }
+
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m;
+        for (const Entry& e : heap) accountPayload(e.elem, m);
+        m.overheadBytes += sizeof(PriorityQueue)
+                         + heap.size() * (sizeof(Entry) - sizeof(PrioritizedElement<T>))
+                         + (heap.capacity() - heap.size()) * sizeof(Entry)
+                         + slots.capacity() * sizeof(Slot)
+                         + livres.capacity() * sizeof(std::uint32_t);
+        if (heap.capacity() > 0) m.addBlock(heap.capacity() * sizeof(Entry));
+        if (slots.capacity() > 0) m.addBlock(slots.capacity() * sizeof(Slot));
+        if (livres.capacity() > 0) m.addBlock(livres.capacity() * sizeof(std::uint32_t));
+        return m;
+    }
+
+    // Retorna um std::vector com todos os elementos, na ordem de saída
     std::vector<PrioritizedElement<T>> getAllElements() const{
         std::vector<PrioritizedElement<T>> elementos;
-        Node<PrioritizedElement<T>>* atual = list.getHead();
-        while(atual != nullptr){
-            elementos.push_back(atual->getInfo());
-            atual = atual->getLink();
-        }
+        elementos.reserve(heap.size());
+        for (const Entry& e : heap) elementos.push_back(e.elem);
+        std::sort(elementos.begin(), elementos.end(), comesBefore);
         return elementos;
     }
 };
@@ -311,18 +1822,40 @@ std::ostream& operator<<(std::ostream& os, const PrioritizedElement<T>& elem) {
     return os;
 }
 
+template <typename T>
+FormatBuffer& operator<<(FormatBuffer& out, const PrioritizedElement<T>& elem) {
+    return out << elem.getValue();
+}
+
 // ===================================================
 // Sobrecarga do operador << para LinkedList
 // ===================================================
 
 template <typename T>
 std::ostream& operator<<(std::ostream& os, const LinkedList<T>& list) {
-    Node<T>* current = list.getHead();
     os << "Itens da lista: ";
-    while (current != nullptr) {
-        os << current->getInfo() << " ";
-        current = current->getLink();
+    if (!streamIsPlain(os)) {
+        for (const T& x : list) os << x << " ";
+        return os;
     }
+    FormatBuffer out(os);
+    formatRange(out, list.begin(), list.end(), FormatOptions::classic());
+    return os;
+}
+
+// ===================================================
+// Sobrecarga do operador << para UnrolledLinkedList
+// ===================================================
+
+template <typename T, std::size_t Cap>
+std::ostream& operator<<(std::ostream& os, const UnrolledLinkedList<T, Cap>& list) {
+    os << "Itens da lista: ";
+    if (!streamIsPlain(os)) {
+        for (const T& x : list) os << x << " ";
+        return os;
+    }
+    FormatBuffer out(os);
+    formatRange(out, list.begin(), list.end(), FormatOptions::classic());
     return os;
 }
 
@@ -330,17 +1863,120 @@ std::ostream& operator<<(std::ostream& os, const LinkedList<T>& list) {
 // Classe BST (Árvore de Busca)
 // ===============================
 
-template <typename T>
+// Dica de prefetch (ignorada em compiladores sem o builtin)
+inline void prefetchRead(const void* p) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p, 0, 3);
+#else
+    (void)p;
+#endif
+}
+
+// Ligações de árvore binária com ponteiro para o pai, comuns à BST e à
+// IntrusiveBST: N é qualquer tipo com membros left, right e parent (N*)
+
+template <typename N>
+N* treeMinimum(N* n) {
+    while (n && n->left) n = n->left;
+    return n;
+}
+
+template <typename N>
+N* treeMaximum(N* n) {
+    while (n && n->right) n = n->right;
+    return n;
+}
+
+template <typename N>
+N* treeSuccessor(N* n) {
+    if (n->right) return treeMinimum(n->right);
+    N* p = n->parent;
+    while (p && n == p->right) { n = p; p = p->parent; }
+    return p;
+}
+
+template <typename N>
+N* treePredecessor(N* n) {
+    if (n->left) return treeMaximum(n->left);
+    N* p = n->parent;
+    while (p && n == p->left) { n = p; p = p->parent; }
+    return p;
+}
+
+// Coloca v (pode ser nulo) no lugar de u, do ponto de vista do pai de u
+template <typename N>
+void treeTransplant(N*& root, N* u, N* v) {
+    if (!u->parent) root = v;
+    else if (u == u->parent->left) u->parent->left = v;
+    else u->parent->right = v;
+    if (v) v->parent = u->parent;
+}
+
+// Desliga z da árvore (remoção clássica do CLRS: com dois filhos, o
+// sucessor ocupa o lugar de z). Não libera z nem mexe nos ponteiros dele.
+template <typename N>
+void treeUnlink(N*& root, N* z) {
+    if (!z->left) treeTransplant(root, z, z->right);
+    else if (!z->right) treeTransplant(root, z, z->left);
+    else {
+        N* y = treeMinimum(z->right);
+        if (y->parent != z) {
+            treeTransplant(root, y, y->right);
+            y->right = z->right;
+            if (y->right) y->right->parent = y;
+        }
+        treeTransplant(root, z, y);
+        y->left = z->left;
+        if (y->left) y->left->parent = y;
+    }
+}
+
+// Política de balanceamento da BST
+enum class BalancePolicy {
+    None,       // BST simples, sem rebalanceamento
+    Scapegoat,  // reconstrói a subárvore "bode expiatório" quando fica alta demais
+    Splay       // buscas e inserções levam o nó acessado à raiz (auto-ajustável)
+};
+
+template <typename T, typename Compare = std::less<T>>
 class BST {
 public:
     // Nó exposto para visualização (sem dependências gráficas)
-    struct Node {
+    // size e height descrevem a subárvore do nó (folha: 1 e 1) e são
+    // mantidos por toda operação que muda a forma da árvore. No modo
+    // multiset, size soma as multiplicidades da subárvore; a do próprio nó
+    // é size - size(left) - size(right) (veja multiplicity()), sem campo extra.
+    struct Node : CountedAllocation {
         T key;
+        std::uint32_t height = 1;  // logo após a chave: ocupa o alinhamento de chaves pequenas
         Node* left;
         Node* right;
         Node* parent;
+        std::size_t size = 1;
         explicit Node(const T& k, Node* p = nullptr)
             : key(k), left(nullptr), right(nullptr), parent(p) {}
+
+        // Constrói a chave no próprio nó a partir de args
+        template <typename... Args>
+        Node(std::in_place_t, Node* p, Args&&... args)
+            : key(std::forward<Args>(args)...), left(nullptr), right(nullptr), parent(p) {}
+    };
+
+    // Retrato da forma da árvore devolvido por shapeStats(). No modo
+    // multiset as profundidades são ponderadas pela multiplicidade de cada
+    // chave (é o custo médio de acessar um elemento).
+    struct ShapeStats {
+        std::size_t size = 0;
+        int height = 0;              // níveis (0 = vazia, 1 = só a raiz)
+        double averageDepth = 0.0;   // profundidade média das chaves (raiz = 0)
+        double optimalDepth = 0.0;   // média de uma árvore perfeitamente balanceada (1 chave/nó)
+        int p99Depth = 0;
+        // depthHistogram[d] = chaves da amostra na profundidade d; a amostra
+        // tem `sampled` chaves (todas, se exact)
+        std::vector<std::size_t> depthHistogram;
+        std::size_t sampled = 0;
+        bool exact = true;
+        bool needsRebuild = false;   // altura acima de rebuildFactor * log2(n + 1)
     };
 
     // Entrada de layout "neutro": posição normalizada 0..1
@@ -352,66 +1988,642 @@ public:
     };
 
 private:
-    Node* root_;
-    std::size_t sz_;
+    // Bloco contíguo de nós criado por clone(). Os nós de um bloco não são
+    // liberados um a um: apagar só destrói a chave, e a memória volta ao
+    // sistema quando nenhuma árvore usa mais o bloco (split/join/unionWith
+    // podem espalhar os nós por várias árvores, por isso o shared_ptr).
+    struct NodeBlock {
+        explicit NodeBlock(std::size_t n) : mem(CountingAllocator<Node>().allocate(n)), cap(n) {}
+        ~NodeBlock() { CountingAllocator<Node>().deallocate(mem, cap); }
+        NodeBlock(const NodeBlock&) = delete;
+        NodeBlock& operator=(const NodeBlock&) = delete;
+
+        bool owns(const Node* n) const {
+            std::less<const Node*> menor;
+            return !menor(n, mem) && menor(n, mem + cap);
+        }
+
+        Node* mem;
+        std::size_t cap;
+    };
+
+    // mutable: no modo splay até as buscas const reorganizam a árvore
+    mutable Node* root_;
+    std::size_t sz_;              // elementos (com multiset, soma das multiplicidades)
+    std::size_t nodes_ = 0;       // nós (chaves distintas)
+    Compare comp_;
+    bool multiset_ = false;
+
+    BalancePolicy policy_ = BalancePolicy::None;
+    double alpha_ = 0.7;          // fator de peso do scapegoat
+    std::size_t maxSize_ = 0;     // maior tamanho desde a última reconstrução total
+    bool fingerMode_ = false;     // inserções partem do último nó inserido
+    Node* finger_ = nullptr;      // último nó inserido
+    Node* minNode_ = nullptr;     // menor chave (atalho para fluxos decrescentes)
+    Node* maxNode_ = nullptr;     // maior chave (atalho para fluxos crescentes)
+    std::vector<std::shared_ptr<NodeBlock>> blocks_; // blocos de clone() com nós desta árvore
+    std::size_t splayPeriod_ = 1;        // splay a cada k-ésima busca
+    mutable std::atomic<std::size_t> accessCount_{ 0 };
+    mutable std::atomic<Node*> pendingSplay_{ nullptr };  // período > 1: splay adiado
+    mutable std::size_t pathLength_ = 0; // soma das profundidades de todos os nós
+    double rebuildFactor_ = 2.0;         // limite de altura para needsRebuild
+    bool autoRebuild_ = false;
+    double excessSinceRebuild_ = 0.0;    // profundidade extra paga desde a última reconstrução
 
 public:
-    BST() : root_(nullptr), sz_(0) {}
+    BST() : root_(nullptr), sz_(0), comp_() {}
+    explicit BST(const Compare& comp) : root_(nullptr), sz_(0), comp_(comp) {}
     ~BST() { clear(); }
 
+    // Mover só troca ponteiros: O(1), sem tocar nos nós. A árvore de origem
+    // fica vazia e seus iteradores deixam de valer.
+    BST(BST&& o) noexcept : root_(nullptr), sz_(0), comp_(o.comp_) { stealFrom(o); }
+
+    BST& operator=(BST&& o) noexcept {
+        if (this != &o) {
+            clear();
+            comp_ = o.comp_;
+            stealFrom(o);
+        }
+        return *this;
+    }
+
+    // Iterador em ordem (somente leitura), apoiado nos ponteiros parent.
+    // No modo multiset passa por cada chave tantas vezes quanto sua
+    // multiplicidade (k_ conta as repetições já visitadas do nó).
+    class const_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() : n_(nullptr), k_(0), t_(nullptr) {}
+
+        reference operator*() const { return n_->key; }
+        pointer operator->() const { return &n_->key; }
+        const Node* node() const { return n_; }
+
+        const_iterator& operator++() {
+            if (++k_ < multiplicity(n_)) return *this;
+            n_ = successor(const_cast<Node*>(n_));
+            k_ = 0;
+            return *this;
+        }
+        const_iterator operator++(int) { const_iterator c = *this; ++*this; return c; }
+        const_iterator& operator--() {
+            if (n_ && k_ > 0) { --k_; return *this; }
+            n_ = n_ ? predecessor(const_cast<Node*>(n_)) : maximum(t_->root_);
+            k_ = multiplicity(n_) - 1;
+            return *this;
+        }
+        const_iterator operator--(int) { const_iterator c = *this; --*this; return c; }
+
+        bool operator==(const const_iterator& o) const { return n_ == o.n_ && k_ == o.k_; }
+        bool operator!=(const const_iterator& o) const { return !(*this == o); }
+
+    private:
+        friend class BST;
+        const_iterator(const Node* n, const BST* t) : n_(n), k_(0), t_(t) {}
+        const Node* n_;
+        std::size_t k_;
+        const BST* t_;
+    };
+    using iterator = const_iterator;
+
+    const_iterator begin() const { return const_iterator(minNode_, this); }
+    const_iterator end() const { return const_iterator(nullptr, this); }
+
+    // Primeiro elemento com chave >= k
+    const_iterator lowerBound(const T& k) const {
+        Node* cur = root_;
+        Node* res = nullptr;
+        while (cur) {
+            if (comp_(cur->key, k)) cur = cur->right;
+            else { res = cur; cur = cur->left; }
+        }
+        return const_iterator(res, this);
+    }
+
     BST(const BST&) = delete;
     BST& operator=(const BST&) = delete;
 
     Node* root() { return root_; }
     const Node* root() const { return root_; }
+    const Compare& keyComp() const { return comp_; }
 
+    // Elementos; no modo multiset, a soma das multiplicidades
     std::size_t size() const { return sz_; }
     bool empty() const { return sz_ == 0; }
-    void clear() { clearRec(root_); root_ = nullptr; sz_ = 0; }
-
-    // Operações básicas
-    bool contains(const T& k) const { return findNode(k) != nullptr; }
+    // Nós da árvore (chaves distintas)
+    std::size_t distinctSize() const { return nodes_; }
 
-    void insert(const T& k) {
-        if (!root_) { root_ = new Node(k); ++sz_; return; }
-        Node* cur = root_;
-        Node* parent = nullptr;
-        while (cur) {
-            parent = cur;
-            if (k < cur->key) cur = cur->left;
-            else if (cur->key < k) cur = cur->right;
-            else return;
+    // Memória ocupada: um bloco de heap por nó, mais os blocos de clone()
+    // (contados inteiros, mesmo que compartilhados com outras árvores)
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m;
+        accountElements<T>(nodes_, m, [&] {
+            for (const Node* n = minNode_; n; n = successor(const_cast<Node*>(n))) accountPayload(n->key, m);
+        });
+        m.overheadBytes += sizeof(BST) + nodes_ * (sizeof(Node) - sizeof(T));
+        std::size_t emBlocos = 0;
+        if (!blocks_.empty()) {
+            for (const Node* n = minNode_; n; n = successor(const_cast<Node*>(n))) emBlocos += inBlock(n);
+            for (const auto& b : blocks_) {
+                m.addBlock(b->cap * sizeof(Node));
+                m.overheadBytes += sizeof(NodeBlock);
+            }
+            std::size_t capTotal = 0;
+            for (const auto& b : blocks_) capTotal += b->cap;
+            m.overheadBytes += (capTotal - emBlocos) * sizeof(Node);
         }
-        Node* n = new Node(k, parent);
-        if (k < parent->key) parent->left = n; else parent->right = n;
-        ++sz_;
+        m.addBlock(sizeof(Node), nodes_ - emBlocos);
+        return m;
     }
 
-    bool remove(const T& k) {
-        Node* n = findNode(k);
-        if (!n) return false;
-        eraseNode(n);
-        --sz_;
-        return true;
+    void clear() {
+        clearIter(root_);
+        root_ = nullptr;
+        sz_ = 0;
+        nodes_ = 0;
+        pathLength_ = 0;
+        resetCursors();
+        blocks_.clear();
     }
 
-    std::vector<T> preOrder() const { std::vector<T> out; out.reserve(sz_); preOrderRec(root_, out); return out; }
-    std::vector<T> inOrder()  const { std::vector<T> out; out.reserve(sz_); inOrderRec(root_, out);  return out; }
-    std::vector<T> postOrder()const { std::vector<T> out; out.reserve(sz_); postOrderRec(root_, out);return out; }
+    // ==============================================================
+    // Cópia explícita
+    // ==============================================================
+    // Copia estrutura e chaves (mesma forma, mesma política) para um único
+    // bloco contíguo de nós, em pré-ordem e sem recursão. Árvores grandes
+    // são divididas em subárvores copiadas em paralelo; o número de nós de
+    // cada subárvore dá a faixa do bloco de cada tarefa.
 
-    std::vector<LayoutEntry> layoutNormalized() const {
-        std::vector<LayoutEntry> out;
-        const int n = static_cast<int>(sz_);
-        if (n == 0) return out;
+    static constexpr std::size_t kCloneParallel = std::size_t(1) << 15;
 
-        int idx = 0;
-        int maxDepth = 0;
-        layoutInorder(root_, 0, idx, n, out, maxDepth);
+    BST clone() const {
+        BST c(comp_);
+        c.policy_ = policy_;
+        c.alpha_ = alpha_;
+        c.fingerMode_ = fingerMode_;
+        c.splayPeriod_ = splayPeriod_;
+        c.rebuildFactor_ = rebuildFactor_;
+        c.autoRebuild_ = autoRebuild_;
+        c.multiset_ = multiset_;
+        if (!root_) return c;
 
-        // Normaliza y pela profundidade máxima
-        const double denom = (maxDepth == 0) ? 1.0 : static_cast<double>(maxDepth);
-        for (auto& e : out) {
-            e.y = (maxDepth == 0) ? 0.0 : (static_cast<double>(e.depth) / denom);
+        c.blocks_.push_back(std::make_shared<NodeBlock>(nodes_));
+        Node* slots = c.blocks_.back()->mem;
+        const unsigned hw = std::thread::hardware_concurrency();
+        if (nodes_ < kCloneParallel || hw <= 1) copySubtree(root_, nullptr, false, slots, c.root_);
+        else cloneParallel(c, slots, hw);
+
+        c.sz_ = sz_;
+        c.nodes_ = nodes_;
+        c.pathLength_ = pathLength_;
+        c.maxSize_ = sz_;
+        c.minNode_ = minimum(c.root_);
+        c.maxNode_ = maximum(c.root_);
+        return c;
+    }
+
+    // Operações básicas
+    // No splay com período 1, contains/find giram a árvore: mesmo sendo
+    // const, não podem rodar em paralelo com outras operações sem um lock
+    // exclusivo. Com período k > 1 elas só leem (veja setSplayPeriod).
+    bool contains(const T& k) const { return accessNode(k) != nullptr; }
+    Node* find(const T& k) { return accessNode(k); }
+    const Node* find(const T& k) const { return accessNode(k); }
+
+    // Busca heterogênea: com um Compare transparente (ex.: std::less<>) a
+    // chave de busca não precisa ser convertida em T
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    bool contains(const K& k) const { return accessNode(k) != nullptr; }
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    Node* find(const K& k) { return accessNode(k); }
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    const Node* find(const K& k) const { return accessNode(k); }
+
+    // No modo multiset, inserir uma chave existente soma 1 à multiplicidade
+    void insert(const T& k) { insertCounted(insertUnique(k, k)); }
+
+    // Procura a posição de `k`; se a chave não existir, constrói a chave
+    // do nó in-place a partir de args. Retorna o nó e se houve inserção.
+    // No modo finger a busca parte do último nó inserido.
+    template <typename K, typename... Args>
+    std::pair<Node*, bool> insertUnique(const K& k, Args&&... args) {
+        applyPendingSplay();
+        if (fingerMode_ && root_) {
+            // Fluxos monótonos: a nova chave vira filha do extremo em O(1)
+            if (comp_(maxNode_->key, k)) return { attach(maxNode_, false, std::forward<Args>(args)...), true };
+            if (comp_(k, minNode_->key)) return { attach(minNode_, true, std::forward<Args>(args)...), true };
+            if (finger_) return insertFrom(climbFrom(finger_, k), k, std::forward<Args>(args)...);
+        }
+        return insertFrom(root_, k, std::forward<Args>(args)...);
+    }
+
+    // ---- Dicas de posição (hints) e busca por dedo ----
+    // A busca sobe pelos ponteiros parent a partir da dica apenas até o
+    // primeiro ancestral cuja subárvore pode conter k, e desce dali.
+    // Custo O(log d) em árvores balanceadas, d = distância até a dica.
+
+    Node* insert(Node* hint, const T& k) {
+        applyPendingSplay();
+        return insertCounted(insertFrom(hint ? climbFrom(hint, k) : root_, k, k));
+    }
+    const_iterator insert(const_iterator hint, const T& k) {
+        Node* h = hint.n_ ? const_cast<Node*>(hint.n_) : maxNode_;
+        return const_iterator(insert(h, k), this);
+    }
+
+    Node* find(Node* hint, const T& k) {
+        return hint ? findFrom(climbFrom(hint, k), k) : findNode(k);
+    }
+    const_iterator find(const_iterator hint, const T& k) const {
+        Node* h = hint.n_ ? const_cast<Node*>(hint.n_) : maxNode_;
+        return const_iterator(h ? findFrom(climbFrom(h, k), k) : nullptr, this);
+    }
+
+    // Modo "dedo da última inserção": ideal para chaves quase ordenadas
+    void setFingerMode(bool on) {
+        fingerMode_ = on;
+        finger_ = nullptr;
+    }
+    bool fingerMode() const { return fingerMode_; }
+
+    // Troca a política de balanceamento. Ao ligar o scapegoat a árvore é
+    // reconstruída uma vez para partir de um estado balanceado.
+    void setBalancePolicy(BalancePolicy p, double alpha = 0.7) {
+        if (!(alpha > 0.5 && alpha < 1.0)) throw std::invalid_argument("alpha deve estar em (0.5, 1)");
+        policy_ = p;
+        alpha_ = alpha;
+        if (policy_ == BalancePolicy::Scapegoat) rebuildAll();
+    }
+    BalancePolicy balancePolicy() const { return policy_; }
+
+    // Splay: contains/find levam o nó encontrado (ou o último visitado, se
+    // a chave não existe) à raiz por rotações zig/zig-zig/zig-zag, o que dá
+    // O(log n) amortizado e deixa as chaves quentes perto da raiz.
+    // Inserções sempre fazem splay do nó novo; buscas em lote, não.
+    // Com período k > 1 o modo é seguro para leitores concorrentes: uma
+    // busca nunca gira a árvore, só conta (contador atômico) e, a cada k
+    // buscas, anota o nó visitado. O splay anotado acontece na próxima
+    // operação que modifica a árvore (insert, remove, erase) ou em
+    // applyPendingSplay(), chamadas que já exigem acesso exclusivo. As
+    // chaves quentes ainda sobem (são as mais anotadas) e o custo das
+    // rotações cai por k.
+    void setSplayPeriod(std::size_t k) {
+        if (k == 0) throw std::invalid_argument("período deve ser >= 1");
+        splayPeriod_ = k;
+        accessCount_.store(0, std::memory_order_relaxed);
+        applyPendingSplay();
+    }
+    std::size_t splayPeriod() const { return splayPeriod_; }
+
+    // Executa o splay adiado pelas buscas, se houver (escrita: exclusivo)
+    void applyPendingSplay() {
+        Node* n = pendingSplay_.exchange(nullptr, std::memory_order_relaxed);
+        if (n && policy_ == BalancePolicy::Splay) splay(n);
+    }
+
+    // Remove uma ocorrência de k (no modo multiset, a multiplicidade cai 1)
+    bool remove(const T& k) { return eraseKey(k, 1) != 0; }
+    template <typename K, typename C = Compare, typename = typename C::is_transparent>
+    bool remove(const K& k) { return eraseKey(k, 1) != 0; }
+
+    // ==============================================================
+    // Modo multiset
+    // ==============================================================
+    // Cada nó guarda uma chave distinta e sua multiplicidade: fluxos com
+    // muitas repetições ocupam memória O(distintas), não O(total). size(),
+    // select/rank, iteradores e percursos contam cada repetição. Fora do
+    // modo multiset toda multiplicidade é 1 e nada muda.
+    // Com o scapegoat, o balanceamento passa a ser por peso: reconstruções
+    // põem na raiz a mediana ponderada, o que deixa chaves muito repetidas
+    // mais perto do topo.
+
+    // Ao desligar, as multiplicidades voltam a 1 (duplicatas são descartadas)
+    void setMultiset(bool on) {
+        if (on == multiset_) return;
+        multiset_ = on;
+        if (!on && sz_ != nodes_) {
+            std::vector<Node*> nos;
+            nos.reserve(nodes_);
+            collectPreOrder(root_, nos);
+            for (std::size_t i = nos.size(); i-- > 0;)
+                nos[i]->size = 1 + sizeOf(nos[i]->left) + sizeOf(nos[i]->right);
+            sz_ = nodes_;
+            maxSize_ = sz_;
+            pathLength_ = internalPathLength(root_);
+        }
+    }
+    bool multiset() const { return multiset_; }
+
+    // Ocorrências de k (0 ou 1 fora do modo multiset)
+    std::size_t count(const T& k) const {
+        const Node* n = accessNode(k);
+        return n ? multiplicity(n) : 0;
+    }
+
+    // Remove até n ocorrências de k (todas, por padrão) e devolve quantas saíram
+    std::size_t erase(const T& k, std::size_t n = std::size_t(-1)) { return eraseKey(k, n); }
+
+    // Como erase(k, n), partindo de um nó desta árvore (de find ou de um
+    // índice externo) em vez de descer da raiz. Se o nó sair, ele é liberado.
+    std::size_t eraseAt(Node* x, std::size_t n = std::size_t(-1)) {
+        if (!x || n == 0) return 0;
+        applyPendingSplay();
+        const std::size_t c = multiplicity(x);
+        if (n < c) {
+            adjustCount(x, std::size_t(0) - n);
+            afterUpdate();
+            return n;
+        }
+        eraseNode(x);
+        sz_ -= c;
+        --nodes_;
+        if (policy_ == BalancePolicy::Scapegoat &&
+            static_cast<double>(sz_) < alpha_ * static_cast<double>(maxSize_)) {
+            rebuildAll();
+        }
+        afterUpdate();
+        return c;
+    }
+
+    // Multiplicidade guardada no nó
+    static std::size_t multiplicity(const Node* n) { return n->size - sizeOf(n->left) - sizeOf(n->right); }
+
+    // ==============================================================
+    // Forma da árvore e estatísticas de ordem
+    // ==============================================================
+    // Cada nó guarda size e height da sua subárvore, e a árvore guarda a
+    // soma das profundidades de todos os nós. Inserção, remoção, rotações
+    // do splay e reconstruções do scapegoat atualizam isso no caminho que
+    // já percorrem, então altura e profundidade média saem em O(1), e
+    // select/rank em O(altura).
+
+    // Níveis da árvore (0 = vazia)
+    int height() const { return static_cast<int>(heightOf(root_)); }
+
+    // Nó com o i-ésimo menor elemento (a partir de 0, contando
+    // repetições), ou nullptr se i >= size()
+    const Node* select(std::size_t i) const {
+        const Node* n = root_;
+        while (n) {
+            const std::size_t esq = sizeOf(n->left);
+            const std::size_t meu = n->size - esq - sizeOf(n->right);
+            if (i < esq) n = n->left;
+            else if (i < esq + meu) return n;
+            else { i -= esq + meu; n = n->right; }
+        }
+        return nullptr;
+    }
+
+    // Quantos elementos são menores que k
+    std::size_t rank(const T& k) const {
+        std::size_t r = 0;
+        for (const Node* n = root_; n;) {
+            if (comp_(n->key, k)) { r += n->size - sizeOf(n->right); n = n->right; }
+            else n = n->left;
+        }
+        return r;
+    }
+
+    // Altura acima de rebuildFactor * log2(nós + 1): a árvore degenerou o
+    // bastante para valer uma reconstrução balanceada. O(1).
+    bool needsRebuild() const {
+        return nodes_ > 2 && height() > rebuildFactor_ * std::log2(static_cast<double>(nodes_) + 1.0);
+    }
+
+    // Com on, inserções e remoções chamam rebuild() sozinhas quando
+    // needsRebuild() vale e a profundidade extra acumulada desde a última
+    // reconstrução já pagou o O(n) dela. É um vigia contra degeneração,
+    // não uma garantia de altura: para isso há o scapegoat.
+    void setAutoRebuild(bool on, double fator = 2.0) {
+        if (!(fator >= 1.0)) throw std::invalid_argument("fator deve ser >= 1");
+        autoRebuild_ = on;
+        rebuildFactor_ = fator;
+    }
+    bool autoRebuild() const { return autoRebuild_; }
+    double rebuildFactor() const { return rebuildFactor_; }
+
+    // Reconstrói a árvore inteira balanceada, em O(n)
+    void rebuild() { rebuildAll(); }
+
+    // Altura, profundidade média e needsRebuild são exatos e O(1). O
+    // histograma de profundidades (e o p99 tirado dele) vem de `amostras`
+    // elementos de postos igualmente espaçados, cada um achado por select
+    // em O(altura); com até `amostras` nós a árvore toda é percorrida e o
+    // resultado é exato. Custo O(amostras * altura).
+    ShapeStats shapeStats(std::size_t amostras = 1024) const {
+        ShapeStats st;
+        st.size = sz_;
+        st.height = height();
+        if (!root_) return st;
+        st.averageDepth = static_cast<double>(pathLength_) / static_cast<double>(sz_);
+        st.needsRebuild = needsRebuild();
+
+        // Na árvore perfeita há 2^d nós em cada nível d, menos no último
+        std::size_t resto = nodes_, nivel = 1, soma = 0;
+        for (std::size_t d = 0; resto > 0; ++d, nivel *= 2) {
+            const std::size_t c = std::min(resto, nivel);
+            soma += c * d;
+            resto -= c;
+        }
+        st.optimalDepth = static_cast<double>(soma) / static_cast<double>(nodes_);
+
+        st.depthHistogram.assign(static_cast<std::size_t>(st.height), 0);
+        if (amostras == 0) amostras = 1;
+        if (nodes_ <= amostras) {
+            std::vector<std::pair<const Node*, std::size_t>> pilha{ { root_, 0 } };
+            while (!pilha.empty()) {
+                const auto [x, d] = pilha.back();
+                pilha.pop_back();
+                st.depthHistogram[d] += multiplicity(x);
+                if (x->left) pilha.emplace_back(x->left, d + 1);
+                if (x->right) pilha.emplace_back(x->right, d + 1);
+            }
+            st.sampled = sz_;
+        } else {
+            st.exact = false;
+            for (std::size_t a = 0; a < amostras; ++a) {
+                std::size_t i = (2 * a + 1) * sz_ / (2 * amostras);
+                std::size_t d = 0;
+                for (const Node* n = root_;; ++d) {
+                    const std::size_t esq = sizeOf(n->left);
+                    const std::size_t meu = n->size - esq - sizeOf(n->right);
+                    if (i < esq) n = n->left;
+                    else if (i < esq + meu) break;
+                    else { i -= esq + meu; n = n->right; }
+                }
+                ++st.depthHistogram[d];
+            }
+            st.sampled = amostras;
+        }
+
+        std::size_t acumulado = 0;
+        for (std::size_t d = 0; d < st.depthHistogram.size(); ++d) {
+            acumulado += st.depthHistogram[d];
+            if (100 * acumulado >= 99 * st.sampled) { st.p99Depth = static_cast<int>(d); break; }
+        }
+        return st;
+    }
+
+    // ==============================================================
+    // Buscas em lote
+    // ==============================================================
+    // Cada busca isolada é uma cadeia de faltas de cache dependentes. Aqui
+    // mantemos kBatchInFlight buscas em andamento e as avançamos um nível
+    // por vez em rodízio (AMAC), com prefetch do próximo nó de cada uma:
+    // enquanto um nó chega da memória, as outras buscas trabalham.
+
+    static constexpr std::size_t kBatchInFlight = 16;
+
+    // out[i] = contains(keys[i])
+    void containsBatch(const std::vector<T>& keys, std::vector<bool>& out) const {
+        out.assign(keys.size(), false);
+        batchLookup(keys.data(), keys.size(), [&out](std::size_t i, const Node* n) { out[i] = (n != nullptr); });
+    }
+
+    // out[i] = nó com a chave keys[i] (nullptr se não existir)
+    void findBatch(const std::vector<T>& keys, std::vector<const Node*>& out) const {
+        out.assign(keys.size(), nullptr);
+        batchLookup(keys.data(), keys.size(), [&out](std::size_t i, const Node* n) { out[i] = n; });
+    }
+
+    // ==============================================================
+    // Álgebra de conjuntos, split e join
+    // ==============================================================
+    // Todas as operações abaixo achatam as árvores em vetores de nós (em
+    // ordem), intercalam os fluxos em O(n + m) e reconstroem uma árvore
+    // balanceada reaproveitando os próprios nós, sem novas alocações.
+    // No modo multiset valem as operações de multiconjunto: a união soma
+    // multiplicidades, a interseção fica com a menor e a diferença subtrai.
+
+    // Divide a árvore: chaves < k vão para `menores`, chaves >= k para
+    // `maiores`. O conteúdo anterior dos destinos é descartado e a árvore
+    // atual fica vazia (ela pode ser um dos destinos).
+    void split(const T& k, BST& menores, BST& maiores) {
+        if (&menores == &maiores) throw std::invalid_argument("split: destinos iguais");
+        std::vector<Node*> nos = detachNodes();
+        const std::size_t corte = static_cast<std::size_t>(
+            std::lower_bound(nos.begin(), nos.end(), k,
+                             [this](const Node* n, const T& v) { return comp_(n->key, v); }) - nos.begin());
+        const auto blocos = blocks_;
+        const bool ms = multiset_;
+        menores.clear();
+        maiores.clear();
+        menores.multiset_ = maiores.multiset_ = ms;
+        menores.adoptSorted(nos, 0, corte);
+        maiores.adoptSorted(nos, corte, nos.size());
+        menores.shareBlocks(blocos);
+        maiores.shareBlocks(blocos);
+    }
+
+    // Junta duas árvores em que toda chave de `esq` é menor que toda chave
+    // de `dir`. As duas ficam vazias e o resultado substitui esta árvore.
+    void join(BST& esq, BST& dir) {
+        if (&esq == &dir) throw std::invalid_argument("join: origens iguais");
+        if (!esq.empty() && !dir.empty() &&
+            !comp_(maximum(esq.root_)->key, minimum(dir.root_)->key)) {
+            throw std::invalid_argument("join: chaves fora de ordem");
+        }
+        std::vector<Node*> nos = esq.detachNodes();
+        std::vector<Node*> nosDir = dir.detachNodes();
+        nos.insert(nos.end(), nosDir.begin(), nosDir.end());
+        auto blocos = esq.blocks_;
+        blocos.insert(blocos.end(), dir.blocks_.begin(), dir.blocks_.end());
+        clear();
+        adoptSorted(nos, 0, nos.size());
+        shareBlocks(blocos);
+    }
+
+    // this = this ∪ other. Os nós de `other` são movidos para esta árvore
+    // (duplicatas são liberadas, somando a multiplicidade no modo
+    // multiset) e `other` fica vazia.
+    void unionWith(BST& other) {
+        if (&other == this) return;
+        std::vector<Node*> a = detachNodes();
+        std::vector<Node*> b = other.detachNodes();
+        shareBlocks(other.blocks_);
+        other.blocks_.clear();
+        std::vector<Node*> out;
+        out.reserve(a.size() + b.size());
+        std::size_t i = 0, j = 0;
+        while (i < a.size() && j < b.size()) {
+            if (comp_(a[i]->key, b[j]->key)) out.push_back(a[i++]);
+            else if (comp_(b[j]->key, a[i]->key)) out.push_back(b[j++]);
+            else {
+                if (multiset_) a[i]->size += b[j]->size;
+                out.push_back(a[i++]);
+                destroyNode(b[j++]);
+            }
+        }
+        while (i < a.size()) out.push_back(a[i++]);
+        while (j < b.size()) out.push_back(b[j++]);
+        adoptSorted(out, 0, out.size());
+    }
+
+    // this = this ∩ other. Nós sem correspondente em `other` são liberados.
+    void intersect(const BST& other) {
+        if (&other == this) return;
+        std::vector<Node*> a = detachNodes();
+        std::vector<Node*> b;
+        b.reserve(other.sz_);
+        collectInOrder(other.root_, b);
+        std::size_t keep = 0, j = 0;
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            while (j < b.size() && comp_(b[j]->key, a[i]->key)) ++j;
+            if (j < b.size() && !comp_(a[i]->key, b[j]->key)) {
+                if (multiset_) a[i]->size = std::min(a[i]->size, multiplicity(b[j]));
+                a[keep++] = a[i];
+            } else {
+                destroyNode(a[i]);
+            }
+        }
+        adoptSorted(a, 0, keep);
+    }
+
+    // this = this \ other. Nós cujas chaves aparecem em `other` são liberados.
+    void difference(const BST& other) {
+        if (&other == this) { clear(); return; }
+        std::vector<Node*> a = detachNodes();
+        std::vector<Node*> b;
+        b.reserve(other.sz_);
+        collectInOrder(other.root_, b);
+        std::size_t keep = 0, j = 0;
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            while (j < b.size() && comp_(b[j]->key, a[i]->key)) ++j;
+            const std::size_t tira = (j < b.size() && !comp_(a[i]->key, b[j]->key)) ? multiplicity(b[j]) : 0;
+            if (a[i]->size > tira) {
+                a[i]->size -= tira;
+                a[keep++] = a[i];
+            } else {
+                destroyNode(a[i]);
+            }
+        }
+        adoptSorted(a, 0, keep);
+    }
+
+    // Percursos: cada chave aparece tantas vezes quanto sua multiplicidade
+    std::vector<T> preOrder() const { std::vector<T> out; out.reserve(sz_); preOrderRec(root_, out); return out; }
+    std::vector<T> inOrder()  const { std::vector<T> out; out.reserve(sz_); inOrderRec(root_, out);  return out; }
+    std::vector<T> postOrder()const { std::vector<T> out; out.reserve(sz_); postOrderRec(root_, out);return out; }
+
+    std::vector<LayoutEntry> layoutNormalized() const {
+        std::vector<LayoutEntry> out;
+        const int n = static_cast<int>(nodes_);
+        if (n == 0) return out;
+
+        int idx = 0;
+        const int maxDepth = height() - 1;
+        layoutInorder(root_, 0, idx, n, out);
+
+        // Normaliza y pela profundidade máxima
+        const double denom = (maxDepth == 0) ? 1.0 : static_cast<double>(maxDepth);
+        for (auto& e : out) {
+            e.y = (maxDepth == 0) ? 0.0 : (static_cast<double>(e.depth) / denom);
         }
         return out;
     }
@@ -422,81 +2634,3314 @@ public:
 
 private:
     // Utilidades internas
-    void clearRec(Node* n) {
-        if (!n) return;
-        clearRec(n->left);
-        clearRec(n->right);
-        delete n;
+    // Libera a subárvore sem recursão (rotaciona o filho esquerdo para cima)
+    void clearIter(Node* n) {
+        while (n) {
+            if (n->left) {
+                Node* l = n->left;
+                n->left = l->right;
+                l->right = n;
+                n = l;
+            } else {
+                Node* r = n->right;
+                destroyNode(n);
+                n = r;
+            }
+        }
     }
 
-    Node* findNode(const T& k) const {
-        Node* cur = root_;
+    bool inBlock(const Node* n) const {
+        for (const auto& b : blocks_) {
+            if (b->owns(n)) return true;
+        }
+        return false;
+    }
+
+    // Nós de blocos só têm a chave destruída; os demais voltam ao heap
+    void destroyNode(Node* n) {
+        if (pendingSplay_.load(std::memory_order_relaxed) == n) pendingSplay_.store(nullptr, std::memory_order_relaxed);
+        if (!blocks_.empty() && inBlock(n)) n->~Node();
+        else delete n;
+    }
+
+    // Passa a compartilhar os blocos de `o` (nós dele vieram para cá)
+    void shareBlocks(const std::vector<std::shared_ptr<NodeBlock>>& outros) {
+        for (const auto& b : outros) {
+            if (std::find(blocks_.begin(), blocks_.end(), b) == blocks_.end()) blocks_.push_back(b);
+        }
+    }
+
+    // Toma tudo de `o` (que fica vazia); esta árvore já deve estar vazia
+    void stealFrom(BST& o) {
+        root_ = o.root_;
+        sz_ = o.sz_;
+        nodes_ = o.nodes_;
+        multiset_ = o.multiset_;
+        policy_ = o.policy_;
+        alpha_ = o.alpha_;
+        maxSize_ = o.maxSize_;
+        fingerMode_ = o.fingerMode_;
+        finger_ = o.finger_;
+        minNode_ = o.minNode_;
+        maxNode_ = o.maxNode_;
+        splayPeriod_ = o.splayPeriod_;
+        pendingSplay_.store(o.pendingSplay_.exchange(nullptr, std::memory_order_relaxed), std::memory_order_relaxed);
+        pathLength_ = o.pathLength_;
+        rebuildFactor_ = o.rebuildFactor_;
+        autoRebuild_ = o.autoRebuild_;
+        excessSinceRebuild_ = o.excessSinceRebuild_;
+        blocks_ = std::move(o.blocks_);
+        o.blocks_.clear();
+        o.root_ = nullptr;
+        o.sz_ = 0;
+        o.nodes_ = 0;
+        o.pathLength_ = 0;
+        o.resetCursors();
+    }
+
+    // Copia a subárvore src em pré-ordem para slots[0..), pendurando a
+    // cópia em pai (ou em raiz, se pai for nulo). Devolve o próximo slot livre.
+    static Node* copySubtree(const Node* src, Node* pai, bool esquerda, Node* slots, Node*& raiz) {
+        struct Pendente {
+            const Node* src;
+            Node* pai;
+            bool esquerda;
+        };
+        std::vector<Pendente> pilha;
+        pilha.push_back(Pendente{ src, pai, esquerda });
+        while (!pilha.empty()) {
+            const Pendente p = pilha.back();
+            pilha.pop_back();
+            Node* n = ::new (static_cast<void*>(slots++)) Node(p.src->key, p.pai);
+            n->size = p.src->size;
+            n->height = p.src->height;
+            if (!p.pai) raiz = n;
+            else if (p.esquerda) p.pai->left = n;
+            else p.pai->right = n;
+            if (p.src->right) pilha.push_back(Pendente{ p.src->right, n, false });
+            if (p.src->left) pilha.push_back(Pendente{ p.src->left, n, true });
+        }
+        return slots;
+    }
+
+    // Copia os níveis de cima em sequência até haver subárvores suficientes
+    // para as threads; depois copia essas subárvores em paralelo
+    void cloneParallel(BST& c, Node* slots, unsigned hw) const {
+        struct Tarefa {
+            const Node* src;
+            Node* pai;
+            bool esquerda;
+            std::size_t tam;  // nós da subárvore
+            Node* destino;
+        };
+        const std::size_t alvo = std::size_t(hw) * 8;
+        std::vector<Tarefa> fronteira{ Tarefa{ root_, nullptr, false, 0, nullptr } };
+        // Em árvores degeneradas a fronteira não cresce: limitamos os níveis
+        for (int nivel = 0; nivel < 64 && fronteira.size() < alvo; ++nivel) {
+            std::vector<Tarefa> prox;
+            for (const Tarefa& t : fronteira) {
+                Node* n = ::new (static_cast<void*>(slots++)) Node(t.src->key, t.pai);
+                n->size = t.src->size;
+                n->height = t.src->height;
+                if (!t.pai) c.root_ = n;
+                else if (t.esquerda) t.pai->left = n;
+                else t.pai->right = n;
+                if (t.src->left) prox.push_back(Tarefa{ t.src->left, n, true, 0, nullptr });
+                if (t.src->right) prox.push_back(Tarefa{ t.src->right, n, false, 0, nullptr });
+            }
+            fronteira.swap(prox);
+            if (fronteira.empty()) return;
+        }
+
+        // Cada thread pega a próxima tarefa livre de um contador atômico. Se
+        // a cópia de uma chave lançar, as demais tarefas param e a exceção
+        // é relançada aqui; a cópia parcial continua uma árvore válida
+        // (cada nó é ligado ao pai logo que construído) e `c` a libera.
+        auto emParalelo = [&](auto&& trabalho) {
+            std::atomic<std::size_t> proxima{ 0 };
+            std::exception_ptr erro;
+            std::mutex erroMtx;
+            auto laco = [&] {
+                try {
+                    std::size_t i;
+                    while ((i = proxima.fetch_add(1)) < fronteira.size()) trabalho(fronteira[i]);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(erroMtx);
+                    if (!erro) erro = std::current_exception();
+                    proxima = fronteira.size();
+                }
+            };
+            std::vector<std::thread> ts;
+            for (unsigned k = 1; k < hw; ++k) ts.emplace_back(laco);
+            laco();
+            for (auto& t : ts) t.join();
+            if (erro) std::rethrow_exception(erro);
+        };
+
+        // size já é o número de nós, exceto no modo multiset (soma das
+        // multiplicidades): aí as subárvores são contadas, também em paralelo
+        if (multiset_) emParalelo([](Tarefa& t) { t.tam = countNodes(t.src); });
+        else for (Tarefa& t : fronteira) t.tam = t.src->size;
+        for (Tarefa& t : fronteira) {
+            t.destino = slots;
+            slots += t.tam;
+        }
+        // Subárvores distintas escrevem em faixas distintas do bloco; dois
+        // irmãos gravam campos diferentes (left/right) do mesmo pai
+        emParalelo([&c](Tarefa& t) { copySubtree(t.src, t.pai, t.esquerda, t.destino, c.root_); });
+    }
+
+    void resetCursors() {
+        finger_ = minNode_ = maxNode_ = nullptr;
+        pendingSplay_.store(nullptr, std::memory_order_relaxed);
+        maxSize_ = sz_;
+    }
+
+    static Node* successor(Node* n) { return treeSuccessor(n); }
+    static Node* predecessor(Node* n) { return treePredecessor(n); }
+
+    // Sobe de x até o primeiro nó cuja subárvore cobre k (ou cuja chave é k)
+    template <typename K>
+    Node* climbFrom(Node* x, const K& k) const {
+        while (true) {
+            Node* y = x;
+            if (comp_(k, x->key)) {
+                // limite inferior da subárvore de x: primeiro ancestral à esquerda
+                while (y->parent && y == y->parent->left) y = y->parent;
+                Node* a = y->parent;
+                if (!a || comp_(a->key, k)) return x;
+                x = a;
+            } else if (comp_(x->key, k)) {
+                while (y->parent && y == y->parent->right) y = y->parent;
+                Node* a = y->parent;
+                if (!a || comp_(k, a->key)) return x;
+                x = a;
+            } else {
+                return x;
+            }
+        }
+    }
+
+    template <typename K>
+    Node* findFrom(Node* cur, const K& k) const {
         while (cur) {
-            if (k < cur->key) cur = cur->left;
-            else if (cur->key < k) cur = cur->right;
+            if (comp_(k, cur->key)) cur = cur->left;
+            else if (comp_(cur->key, k)) cur = cur->right;
             else return cur;
         }
         return nullptr;
     }
 
-    static Node* minimum(Node* n) {
-        while (n && n->left) n = n->left;
+    template <typename K, typename... Args>
+    std::pair<Node*, bool> insertFrom(Node* cur, const K& k, Args&&... args) {
+        Node* parent = nullptr;
+        bool esquerda = false;
+        while (cur) {
+            parent = cur;
+            if (comp_(k, cur->key)) { cur = cur->left; esquerda = true; }
+            else if (comp_(cur->key, k)) { cur = cur->right; esquerda = false; }
+            else return { cur, false };
+        }
+        return { attach(parent, esquerda, std::forward<Args>(args)...), true };
+    }
+
+    // Cria o nó como filho de parent (ou raiz) e atualiza os cursores
+    template <typename... Args>
+    Node* attach(Node* parent, bool esquerda, Args&&... args) {
+        Node* n = new Node(std::in_place, parent, std::forward<Args>(args)...);
+        if (!parent) root_ = n;
+        else if (esquerda) parent->left = n;
+        else parent->right = n;
+        ++sz_;
+        ++nodes_;
+        std::size_t depth = 0;
+        for (Node* a = parent; a; a = a->parent) {
+            ++depth;
+            ++a->size;
+            pullHeight(a);
+        }
+        pathLength_ += depth;
+
+        if (!minNode_ || comp_(n->key, minNode_->key)) minNode_ = n;
+        if (!maxNode_ || comp_(maxNode_->key, n->key)) maxNode_ = n;
+        finger_ = n;
+        if (policy_ == BalancePolicy::Scapegoat) {
+            if (sz_ > maxSize_) maxSize_ = sz_;
+            rebalanceAfterInsert(n, depth);
+        } else if (policy_ == BalancePolicy::Splay) {
+            splay(n);
+        }
+        afterUpdate();
+        return n;
+    }
+
+    // Sobe x um nível (rotação simples sobre o pai), ajustando os parent
+    void rotateUp(Node* x) const {
+        Node* p = x->parent;
+        Node* g = p->parent;
+        // x e seu lado externo sobem um nível; p e seu outro filho descem um
+        const std::size_t cx = multiplicity(x);
+        const std::size_t cp = multiplicity(p);
+        const Node* sobe = x == p->left ? x->left : x->right;
+        const Node* desce = x == p->left ? p->right : p->left;
+        pathLength_ = pathLength_ + cp + sizeOf(desce) - cx - sizeOf(sobe);
+        if (x == p->left) {
+            p->left = x->right;
+            if (x->right) x->right->parent = p;
+            x->right = p;
+        } else {
+            p->right = x->left;
+            if (x->left) x->left->parent = p;
+            x->left = p;
+        }
+        p->parent = x;
+        x->parent = g;
+        if (!g) root_ = x;
+        else if (g->left == p) g->left = x;
+        else g->right = x;
+        p->size = cp + sizeOf(p->left) + sizeOf(p->right);
+        pullHeight(p);
+        x->size = cx + sizeOf(x->left) + sizeOf(x->right);
+        pullHeight(x);
+    }
+
+    // Leva x até a raiz (const pelo mesmo motivo de root_ ser mutable)
+    void splay(Node* x) const {
+        while (Node* p = x->parent) {
+            Node* g = p->parent;
+            if (!g) rotateUp(x);                                  // zig
+            else if ((g->left == p) == (p->left == x)) { rotateUp(p); rotateUp(x); } // zig-zig
+            else { rotateUp(x); rotateUp(x); }                    // zig-zag
+        }
+    }
+
+    // Busca de contains/find: no modo splay, reorganiza a cada k-ésima
+    template <typename K>
+    Node* accessNode(const K& k) const {
+        if (policy_ != BalancePolicy::Splay) return findNode(k);
+        Node* cur = root_;
+        Node* ultimo = nullptr;
+        while (cur) {
+            ultimo = cur;
+            if (comp_(k, cur->key)) cur = cur->left;
+            else if (comp_(cur->key, k)) cur = cur->right;
+            else break;
+        }
+        if (!ultimo) return cur;
+        if (splayPeriod_ == 1) {
+            splay(ultimo);
+        } else if ((accessCount_.fetch_add(1, std::memory_order_relaxed) + 1) % splayPeriod_ == 0) {
+            pendingSplay_.store(ultimo, std::memory_order_relaxed);
+        }
+        return cur;
+    }
+
+    // ---- Aumento por nó (size/height) ----
+    static std::size_t sizeOf(const Node* n) { return n ? n->size : 0; }
+    static std::uint32_t heightOf(const Node* n) { return n ? n->height : 0; }
+
+    // size não é recalculado dos filhos: a multiplicidade do nó só existe
+    // como size - size(filhos), então cada operação ajusta size pela
+    // diferença que causou. height, sim, vem dos filhos.
+    static void pullHeight(Node* n) {
+        n->height = 1 + std::max(heightOf(n->left), heightOf(n->right));
+    }
+
+    // Recalcula height de n até a raiz (depois de mudar a subárvore de n)
+    static void pullHeightUp(Node* n) {
+        for (; n; n = n->parent) pullHeight(n);
+    }
+
+    static std::size_t depthOf(const Node* n) {
+        std::size_t d = 0;
+        for (; n->parent; n = n->parent) ++d;
+        return d;
+    }
+
+    // Soma das profundidades dos elementos da subárvore, relativas a n
+    static std::size_t internalPathLength(const Node* n) {
+        std::size_t total = 0;
+        std::vector<std::pair<const Node*, std::size_t>> pilha;
+        if (n) pilha.emplace_back(n, 0);
+        while (!pilha.empty()) {
+            const auto [x, d] = pilha.back();
+            pilha.pop_back();
+            total += d * multiplicity(x);
+            if (x->left) pilha.emplace_back(x->left, d + 1);
+            if (x->right) pilha.emplace_back(x->right, d + 1);
+        }
+        return total;
+    }
+
+    // Se o novo nó ficou fundo demais, procura o primeiro ancestral com
+    // filho pesado demais (size(filho) > alpha * size(pai)) e o reconstrói
+    void rebalanceAfterInsert(Node* n, std::size_t depth) {
+        const double limite = std::log(static_cast<double>(maxSize_)) / std::log(1.0 / alpha_);
+        if (static_cast<double>(depth) <= limite) return;
+
+        for (Node* x = n; x->parent; x = x->parent) {
+            Node* p = x->parent;
+            if (static_cast<double>(x->size) > alpha_ * static_cast<double>(p->size)) {
+                rebuildSubtree(p);
+                return;
+            }
+        }
+    }
+
+    void rebuildSubtree(Node* y) {
+        Node* p = y->parent;
+        const bool esquerda = p && p->left == y;
+        // O tamanho não muda, então a profundidade de y se cancela na diferença
+        const std::size_t antes = internalPathLength(y);
+        std::vector<Node*> nos;
+        collectDetached(y, nos);
+        Node* r = buildFrom(nos, 0, nos.size(), p);
+        if (!p) root_ = r;
+        else if (esquerda) p->left = r;
+        else p->right = r;
+        pathLength_ = pathLength_ - antes + internalPathLength(r);
+        pullHeightUp(p);
+    }
+
+    void rebuildAll() {
+        if (!root_) return;
+        rebuildSubtree(root_);
+        maxSize_ = sz_;
+        excessSinceRebuild_ = 0.0;
+    }
+
+    // Reconstrução automática. Cada atualização soma quanto a profundidade
+    // média passa do ideal (~log2 n - 1, n = nós); quando essa soma chega
+    // a n, as operações já gastaram a mais o que custa reconstruir, e a
+    // árvore é refeita se needsRebuild() também valer.
+    void afterUpdate() {
+        if (!autoRebuild_ || sz_ == 0) return;
+        const double ideal = std::log2(static_cast<double>(nodes_) + 1.0) - 1.0;
+        const double media = static_cast<double>(pathLength_) / static_cast<double>(sz_);
+        if (media > ideal) excessSinceRebuild_ += media - ideal;
+        if (excessSinceRebuild_ >= static_cast<double>(nodes_) && needsRebuild()) rebuildAll();
+    }
+
+    // Soma delta (com sinal, em aritmética modular) à multiplicidade de n
+    void adjustCount(Node* n, std::size_t delta) {
+        std::size_t d = 0;
+        for (Node* a = n; a; a = a->parent) {
+            a->size += delta;
+            ++d;
+        }
+        pathLength_ += (d - 1) * delta;
+        sz_ += delta;
+    }
+
+    // Resultado de insertUnique/insertFrom: no modo multiset, uma chave que
+    // já existia ganha mais uma ocorrência
+    Node* insertCounted(std::pair<Node*, bool> r) {
+        if (!r.second && multiset_) {
+            adjustCount(r.first, 1);
+            if (sz_ > maxSize_) maxSize_ = sz_;
+            if (policy_ == BalancePolicy::Splay) splay(r.first);
+            afterUpdate();
+        }
+        return r.first;
+    }
+
+    template <typename K>
+    Node* findNode(const K& k) const {
+        return findFrom(root_, k);
+    }
+
+    // Tira até n ocorrências de k; o nó sai quando a multiplicidade zera
+    template <typename K>
+    std::size_t eraseKey(const K& k, std::size_t n) {
+        return eraseAt(findNode(k), n);
+    }
+
+    static Node* minimum(Node* n) { return treeMinimum(n); }
+
+    // Motor das buscas em lote: sink(i, nó ou nullptr) para cada chave
+    template <typename Sink>
+    void batchLookup(const T* keys, std::size_t n, Sink sink) const {
+        struct Busca {
+            const Node* no;
+            std::size_t idx;
+        };
+        Busca voo[kBatchInFlight];
+        std::size_t ativos = 0;
+        std::size_t proxima = 0;
+        while (ativos < kBatchInFlight && proxima < n) voo[ativos++] = Busca{ root_, proxima++ };
+
+        while (ativos > 0) {
+            for (std::size_t i = 0; i < ativos;) {
+                Busca& b = voo[i];
+                const Node* achado = nullptr;
+                if (const Node* c = b.no) {
+                    const T& k = keys[b.idx];
+                    const Node* prox = nullptr;
+                    if (comp_(k, c->key)) prox = c->left;
+                    else if (comp_(c->key, k)) prox = c->right;
+                    else achado = c;
+                    if (prox) {
+                        b.no = prox;
+                        prefetchRead(prox);
+                        ++i;
+                        continue;
+                    }
+                }
+                sink(b.idx, achado);
+                // Busca terminada: entra a próxima chave no mesmo lugar
+                if (proxima < n) b = Busca{ root_, proxima++ };
+                else voo[i] = voo[--ativos];
+            }
+        }
+    }
+
+    static Node* maximum(Node* n) { return treeMaximum(n); }
+
+    // Coleta os nós em ordem sem recursão (a árvore pode estar degenerada)
+    static void collectInOrder(Node* n, std::vector<Node*>& out) {
+        std::vector<Node*> pilha;
+        while (n || !pilha.empty()) {
+            while (n) { pilha.push_back(n); n = n->left; }
+            n = pilha.back();
+            pilha.pop_back();
+            out.push_back(n);
+            n = n->right;
+        }
+    }
+
+    static void collectPreOrder(Node* n, std::vector<Node*>& out) {
+        std::vector<Node*> pilha;
+        if (n) pilha.push_back(n);
+        while (!pilha.empty()) {
+            Node* x = pilha.back();
+            pilha.pop_back();
+            out.push_back(x);
+            if (x->right) pilha.push_back(x->right);
+            if (x->left) pilha.push_back(x->left);
+        }
+    }
+
+    static std::size_t countNodes(const Node* n) {
+        std::size_t total = 0;
+        std::vector<const Node*> pilha;
+        if (n) pilha.push_back(n);
+        while (!pilha.empty()) {
+            const Node* x = pilha.back();
+            pilha.pop_back();
+            ++total;
+            if (x->left) pilha.push_back(x->left);
+            if (x->right) pilha.push_back(x->right);
+        }
+        return total;
+    }
+
+    // Coleta a subárvore em ordem para religá-la. Soltos, os nós levam a
+    // própria multiplicidade em size até buildFrom refazer as somas.
+    void collectDetached(Node* n, std::vector<Node*>& out) const {
+        const std::size_t ini = out.size();
+        collectInOrder(n, out);
+        if (!multiset_) {
+            for (std::size_t i = ini; i < out.size(); ++i) out[i]->size = 1;
+            return;
+        }
+        std::vector<std::size_t> c;
+        c.reserve(out.size() - ini);
+        for (std::size_t i = ini; i < out.size(); ++i) c.push_back(multiplicity(out[i]));
+        for (std::size_t i = ini; i < out.size(); ++i) out[i]->size = c[i - ini];
+    }
+
+    // Retira todos os nós da árvore (em ordem), deixando-a vazia
+    std::vector<Node*> detachNodes() {
+        std::vector<Node*> nos;
+        nos.reserve(nodes_);
+        collectDetached(root_, nos);
+        root_ = nullptr;
+        sz_ = 0;
+        nodes_ = 0;
+        pathLength_ = 0;
+        resetCursors();
+        return nos;
+    }
+
+    // Religa nos[lo, hi) (em ordem, soltos) como uma árvore balanceada.
+    // Com pref (pref[i - base] = soma das multiplicidades antes de nos[i]),
+    // a raiz de cada faixa é a mediana ponderada em vez da do meio.
+    static Node* buildBalanced(std::vector<Node*>& nos, std::size_t lo, std::size_t hi, Node* parent,
+                               const std::size_t* pref = nullptr, std::size_t base = 0) {
+        if (lo >= hi) return nullptr;
+        std::size_t mid = lo + (hi - lo) / 2;
+        if (pref) {
+            const std::size_t alvo = (pref[lo - base] + pref[hi - base]) / 2;
+            mid = static_cast<std::size_t>(std::upper_bound(pref + (lo - base) + 1, pref + (hi - base) + 1, alvo) - pref) - 1 + base;
+        }
+        Node* n = nos[mid];
+        const std::size_t proprio = n->size;
+        n->parent = parent;
+        n->left = buildBalanced(nos, lo, mid, n, pref, base);
+        n->right = buildBalanced(nos, mid + 1, hi, n, pref, base);
+        n->size = proprio + sizeOf(n->left) + sizeOf(n->right);
+        pullHeight(n);
         return n;
     }
 
-    void transplant(Node* u, Node* v) {
-        if (!u->parent) root_ = v;
-        else if (u == u->parent->left) u->parent->left = v;
-        else u->parent->right = v;
-        if (v) v->parent = u->parent;
+    Node* buildFrom(std::vector<Node*>& nos, std::size_t lo, std::size_t hi, Node* parent) const {
+        if (!multiset_) return buildBalanced(nos, lo, hi, parent);
+        std::vector<std::size_t> pref(hi - lo + 1, 0);
+        for (std::size_t i = lo; i < hi; ++i) pref[i - lo + 1] = pref[i - lo] + nos[i]->size;
+        return buildBalanced(nos, lo, hi, parent, pref.data(), lo);
+    }
+
+    // Substitui o conteúdo (vazio) da árvore pelos nós soltos nos[lo, hi)
+    void adoptSorted(std::vector<Node*>& nos, std::size_t lo, std::size_t hi) {
+        sz_ = 0;
+        for (std::size_t i = lo; i < hi; ++i) {
+            if (!multiset_) nos[i]->size = 1;
+            sz_ += nos[i]->size;
+        }
+        nodes_ = hi - lo;
+        root_ = buildFrom(nos, lo, hi, nullptr);
+        pathLength_ = internalPathLength(root_);
+        resetCursors();
+        if (lo < hi) {
+            minNode_ = nos[lo];
+            maxNode_ = nos[hi - 1];
+        }
     }
 
     void eraseNode(Node* z) {
-        if (!z->left) transplant(z, z->right);
-        else if (!z->right) transplant(z, z->left);
-        else {
-            Node* y = minimum(z->right);
-            if (y->parent != z) {
-                transplant(y, y->right);
-                y->right = z->right;
-                if (y->right) y->right->parent = y;
+        if (z == minNode_) minNode_ = successor(z);
+        if (z == maxNode_) maxNode_ = predecessor(z);
+        if (z == finger_) finger_ = nullptr;
+        // Quem sobe: o filho único de z (um nível), ou o sucessor y (até a
+        // profundidade de z) com sua subárvore direita (um nível). `inicio`
+        // é o nó mais baixo cuja subárvore muda.
+        const std::size_t cz = multiplicity(z);
+        const std::size_t dz = depthOf(z);
+        Node* inicio;
+        Node* y = nullptr;
+        if (!z->left || !z->right) {
+            pathLength_ -= dz * cz + sizeOf(z->left ? z->left : z->right);
+            inicio = z->parent;
+        } else {
+            y = minimum(z->right);
+            const std::size_t cy = multiplicity(y);
+            std::size_t dy = dz + 1;
+            for (Node* a = y->parent; a != z; a = a->parent) {  // perdem y
+                a->size -= cy;
+                ++dy;
             }
-            transplant(z, y);
-            y->left = z->left;
-            if (y->left) y->left->parent = y;
+            pathLength_ -= dz * cz + cy * (dy - dz) + sizeOf(y->right);
+            inicio = y->parent == z ? y : y->parent;
         }
-        delete z;
+        const std::size_t tamZ = z->size;
+        for (Node* a = z->parent; a; a = a->parent) a->size -= cz;
+        treeUnlink(root_, z);
+        if (y) y->size = tamZ - cz;
+        pullHeightUp(inicio);
+        destroyNode(z);
     }
 
     void preOrderRec(Node* n, std::vector<T>& out) const {
         if (!n) return;
-        out.push_back(n->key);
+        for (std::size_t i = multiplicity(n); i-- > 0;) out.push_back(n->key);
         preOrderRec(n->left, out);
         preOrderRec(n->right, out);
     }
     void inOrderRec(Node* n, std::vector<T>& out) const {
         if (!n) return;
         inOrderRec(n->left, out);
-        out.push_back(n->key);
+        for (std::size_t i = multiplicity(n); i-- > 0;) out.push_back(n->key);
         inOrderRec(n->right, out);
     }
     void postOrderRec(Node* n, std::vector<T>& out) const {
         if (!n) return;
         postOrderRec(n->left, out);
         postOrderRec(n->right, out);
-        out.push_back(n->key);
+        for (std::size_t i = multiplicity(n); i-- > 0;) out.push_back(n->key);
     }
 
-    void layoutInorder(Node* n, int depth, int& idx, int nTotal,
-                       std::vector<LayoutEntry>& out, int& maxDepth) const {
+    void layoutInorder(Node* n, int depth, int& idx, int nTotal, std::vector<LayoutEntry>& out) const {
         if (!n) return;
-        if (depth > maxDepth) maxDepth = depth;
-        layoutInorder(n->left, depth + 1, idx, nTotal, out, maxDepth);
+        layoutInorder(n->left, depth + 1, idx, nTotal, out);
 
         const double x = (static_cast<double>(idx) + 1.0) / (static_cast<double>(nTotal) + 1.0);
         out.push_back(LayoutEntry{ n, x, 0.0, depth });
         ++idx;
 
-        layoutInorder(n->right, depth + 1, idx, nTotal, out, maxDepth);
+        layoutInorder(n->right, depth + 1, idx, nTotal, out);
+    }
+};
+
+// =======================================
+// Classe BSTMap (Mapa sobre a BST)
+// =======================================
+// Reaproveita a BST guardando o par (chave, valor) direto no nó: o valor
+// fica ao lado da chave, na mesma alocação. A comparação olha só a chave e
+// é transparente, então buscas por K nunca constroem um par temporário.
+
+template <typename K, typename V, typename Compare = std::less<K>>
+class BSTMap {
+public:
+    using Entry = std::pair<const K, V>;
+
+private:
+    struct EntryCompare {
+        using is_transparent = void;
+        Compare comp;
+
+        bool operator()(const Entry& a, const Entry& b) const { return comp(a.first, b.first); }
+        template <typename A>
+        bool operator()(const A& a, const Entry& b) const { return comp(a, b.first); }
+        template <typename B>
+        bool operator()(const Entry& a, const B& b) const { return comp(a.first, b); }
+    };
+
+    using Tree = BST<Entry, EntryCompare>;
+    Tree tree_;
+
+public:
+    using Node = typename Tree::Node;
+
+    BSTMap() : tree_() {}
+    explicit BSTMap(const Compare& comp) : tree_(EntryCompare{ comp }) {}
+
+    std::size_t size() const { return tree_.size(); }
+    bool empty() const { return tree_.empty(); }
+    void clear() { tree_.clear(); }
+
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m = tree_.memoryUsage();
+        m.overheadBytes += sizeof(BSTMap) - sizeof(Tree);
+        return m;
+    }
+
+    bool contains(const K& k) const { return tree_.find(k) != nullptr; }
+
+    // Retorna ponteiro para o valor associado a k (nullptr se não existir)
+    V* find(const K& k) {
+        Node* n = tree_.find(k);
+        return n ? &n->key.second : nullptr;
+    }
+    const V* find(const K& k) const {
+        const Node* n = tree_.find(k);
+        return n ? &n->key.second : nullptr;
+    }
+
+    // Versões heterogêneas, disponíveis quando o próprio Compare é transparente
+    template <typename Q, typename C = Compare, typename = typename C::is_transparent>
+    bool contains(const Q& k) const { return tree_.find(k) != nullptr; }
+    template <typename Q, typename C = Compare, typename = typename C::is_transparent>
+    V* find(const Q& k) {
+        Node* n = tree_.find(k);
+        return n ? &n->key.second : nullptr;
+    }
+    template <typename Q, typename C = Compare, typename = typename C::is_transparent>
+    const V* find(const Q& k) const {
+        const Node* n = tree_.find(k);
+        return n ? &n->key.second : nullptr;
     }
+
+    // Acesso com criação: insere V() se a chave não existir
+    V& operator[](const K& k) {
+        return tryEmplace(k).first->second;
+    }
+
+    // Constrói o valor a partir de args apenas se a chave ainda não existir.
+    // Retorna o par armazenado e se houve inserção.
+    template <typename... Args>
+    std::pair<Entry*, bool> tryEmplace(const K& k, Args&&... args) {
+        auto r = tree_.insertUnique(k, std::piecewise_construct,
+                                    std::forward_as_tuple(k),
+                                    std::forward_as_tuple(std::forward<Args>(args)...));
+        return { &r.first->key, r.second };
+    }
+
+    // Insere ou sobrescreve o valor. Retorna true se a chave era nova.
+    template <typename M>
+    bool insertOrAssign(const K& k, M&& v) {
+        auto r = tree_.insertUnique(k, k, std::forward<M>(v));
+        if (!r.second) r.first->key.second = std::forward<M>(v);
+        return r.second;
+    }
+
+    bool remove(const K& k) { return tree_.remove(k); }
+
+    std::vector<Entry> inOrder() const { return tree_.inOrder(); }
+
+    Tree& tree() { return tree_; }
+    const Tree& tree() const { return tree_; }
 };
+
+// ====================================================
+// Classe HashedBST (BST com índice hash dos nós)
+// ====================================================
+// Para cargas dominadas por contains/find que ainda precisam de ordem
+// (inOrder, lowerBound, varreduras). A BST guarda a ordem e um índice hash
+// de endereçamento aberto (no estilo Swiss table) leva cada chave direto
+// ao seu nó: contains/find custam O(1) esperado, sem descer pela árvore.
+//
+// O índice guarda só ponteiros para nós (8 bytes por posição) e um byte
+// de controle por posição: vazio, apagado ou os 7 bits baixos do hash.
+// A busca compara 16 bytes de controle de uma vez (SSE2, quando houver)
+// e só olha a chave dos nós cujo byte bateu. Os nós da BST nunca mudam de
+// endereço (rotações e reconstruções só religam ponteiros), então o
+// índice continua válido enquanto a árvore se reorganiza.
+
+// Máscara de 16 bits com os bytes de controle de um grupo que satisfazem
+// um teste
+class CtrlGroup {
+public:
+    static constexpr std::size_t kWidth = 16;
+
+    explicit CtrlGroup(const std::int8_t* p)
+#if defined(__SSE2__) || defined(_M_X64)
+        : v_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+    std::uint32_t match(std::int8_t h) const {
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v_, _mm_set1_epi8(h))));
+    }
+    // Vazio ou apagado: os dois têm o bit alto ligado
+    std::uint32_t matchFree() const { return static_cast<std::uint32_t>(_mm_movemask_epi8(v_)); }
+
+private:
+    __m128i v_;
+#else
+        : p_(p) {}
+    std::uint32_t match(std::int8_t h) const {
+        std::uint32_t m = 0;
+        for (std::size_t i = 0; i < kWidth; ++i) m |= static_cast<std::uint32_t>(p_[i] == h) << i;
+        return m;
+    }
+    std::uint32_t matchFree() const {
+        std::uint32_t m = 0;
+        for (std::size_t i = 0; i < kWidth; ++i) m |= static_cast<std::uint32_t>(p_[i] < 0) << i;
+        return m;
+    }
+
+private:
+    const std::int8_t* p_;
+#endif
+};
+
+// Índice do bit menos significativo (m != 0)
+inline unsigned lowestBit(std::uint32_t m) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctz(m));
+#else
+    unsigned i = 0;
+    while (!(m & 1u)) { m >>= 1; ++i; }
+    return i;
+#endif
+}
+
+// Tabela chave -> nó. A chave é lida no próprio nó (node->key), então a
+// tabela não duplica T.
+template <typename Node, typename Hash, typename Eq>
+class NodeHashIndex {
+public:
+    NodeHashIndex() = default;
+    NodeHashIndex(NodeHashIndex&& o) noexcept { swap(o); }
+    NodeHashIndex& operator=(NodeHashIndex&& o) noexcept {
+        if (this != &o) {
+            NodeHashIndex vazio;
+            swap(vazio);
+            swap(o);
+        }
+        return *this;
+    }
+    NodeHashIndex(const NodeHashIndex&) = delete;
+    NodeHashIndex& operator=(const NodeHashIndex&) = delete;
+
+    std::size_t size() const { return sz_; }
+    std::size_t capacity() const { return cap_; }
+
+    void clear() {
+        if (cap_ == 0) return;
+        std::memset(ctrl_.get(), kEmpty, cap_ + CtrlGroup::kWidth);
+        sz_ = 0;
+        apagados_ = 0;
+    }
+
+    // Capacidade para n nós sem crescer
+    void reserve(std::size_t n) {
+        if (n * 8 > cap_ * 7) rehash(n);
+    }
+
+    template <typename K>
+    Node* find(const K& k) const {
+        if (sz_ == 0) return nullptr;
+        const std::size_t h = mix(k);
+        const std::int8_t h2 = static_cast<std::int8_t>(h & 0x7F);
+        std::size_t pos = (h >> 7) & (cap_ - 1);
+        for (std::size_t passo = CtrlGroup::kWidth;; passo += CtrlGroup::kWidth) {
+            const CtrlGroup g(ctrl_.get() + pos);
+            for (std::uint32_t m = g.match(h2); m; m &= m - 1) {
+                Node* n = slots_[(pos + lowestBit(m)) & (cap_ - 1)];
+                if (eq_(n->key, k)) return n;
+            }
+            if (g.match(kEmpty)) return nullptr;
+            pos = (pos + passo) & (cap_ - 1);
+        }
+    }
+
+    // Registra um nó cuja chave ainda não está no índice
+    void insert(Node* n) {
+        if ((sz_ + apagados_ + 1) * 8 > cap_ * 7) rehash(sz_ + 1);
+        const std::size_t h = mix(n->key);
+        const std::size_t i = freeSlot(h);
+        if (ctrl_[i] == kDeleted) --apagados_;
+        setCtrl(i, static_cast<std::int8_t>(h & 0x7F));
+        slots_[i] = n;
+        ++sz_;
+    }
+
+    // Retira o nó n (comparando endereços, não chaves)
+    bool erase(const Node* n) {
+        if (sz_ == 0) return false;
+        const std::size_t h = mix(n->key);
+        const std::int8_t h2 = static_cast<std::int8_t>(h & 0x7F);
+        std::size_t pos = (h >> 7) & (cap_ - 1);
+        for (std::size_t passo = CtrlGroup::kWidth;; passo += CtrlGroup::kWidth) {
+            const CtrlGroup g(ctrl_.get() + pos);
+            for (std::uint32_t m = g.match(h2); m; m &= m - 1) {
+                const std::size_t i = (pos + lowestBit(m)) & (cap_ - 1);
+                if (slots_[i] == n) {
+                    setCtrl(i, kDeleted);
+                    --sz_;
+                    ++apagados_;
+                    return true;
+                }
+            }
+            if (g.match(kEmpty)) return false;
+            pos = (pos + passo) & (cap_ - 1);
+        }
+    }
+
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m;
+        m.overheadBytes = sizeof(NodeHashIndex);
+        if (cap_ == 0) return m;
+        m.overheadBytes += cap_ * sizeof(Node*) + cap_ + CtrlGroup::kWidth;
+        m.addBlock(cap_ * sizeof(Node*));
+        m.addBlock(cap_ + CtrlGroup::kWidth);
+        return m;
+    }
+
+private:
+    static constexpr std::int8_t kEmpty = -128;  // 0x80
+    static constexpr std::int8_t kDeleted = -2;  // 0xFE
+
+    // Arrays de countedAllocate; o deleter guarda o tamanho para o contador
+    template <typename U>
+    struct ArrayDelete {
+        std::size_t n = 0;
+        void operator()(U* p) const noexcept { countedDeallocate(p, n * sizeof(U)); }
+    };
+    template <typename U>
+    using Array = std::unique_ptr<U[], ArrayDelete<U>>;
+
+    // Só para tipos triviais (bytes de controle e ponteiros)
+    template <typename U>
+    static Array<U> newArray(std::size_t n) {
+        return Array<U>(static_cast<U*>(countedAllocate(n * sizeof(U))), ArrayDelete<U>{ n });
+    }
+
+    // ctrl_ tem cap_ + kWidth bytes: os últimos espelham os primeiros, para
+    // que um grupo que passa do fim seja lido sem dar a volta
+    Array<std::int8_t> ctrl_;
+    Array<Node*> slots_;
+    std::size_t cap_ = 0;
+    std::size_t sz_ = 0;
+    std::size_t apagados_ = 0;
+    Hash hash_;
+    Eq eq_;
+
+    void swap(NodeHashIndex& o) noexcept {
+        std::swap(ctrl_, o.ctrl_);
+        std::swap(slots_, o.slots_);
+        std::swap(cap_, o.cap_);
+        std::swap(sz_, o.sz_);
+        std::swap(apagados_, o.apagados_);
+    }
+
+    // std::hash de inteiros costuma ser a identidade: misturamos os bits
+    // para que os 7 de baixo (h2) e os de cima (posição) sejam independentes
+    template <typename K>
+    std::size_t mix(const K& k) const {
+        std::uint64_t x = static_cast<std::uint64_t>(hash_(k));
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return static_cast<std::size_t>(x);
+    }
+
+    void setCtrl(std::size_t i, std::int8_t v) {
+        ctrl_[i] = v;
+        if (i < CtrlGroup::kWidth) ctrl_[cap_ + i] = v;
+    }
+
+    // Primeira posição vazia ou apagada na sequência de sondagem de h
+    std::size_t freeSlot(std::size_t h) const {
+        std::size_t pos = (h >> 7) & (cap_ - 1);
+        for (std::size_t passo = CtrlGroup::kWidth;; passo += CtrlGroup::kWidth) {
+            const std::uint32_t m = CtrlGroup(ctrl_.get() + pos).matchFree();
+            if (m) return (pos + lowestBit(m)) & (cap_ - 1);
+            pos = (pos + passo) & (cap_ - 1);
+        }
+    }
+
+    // Nova tabela para pelo menos n nós a no máximo 7/8 de ocupação; os
+    // apagados somem. Se n já cabe, a tabela só é limpa dos apagados (ou
+    // dobra, quando está quase cheia de nós vivos).
+    void rehash(std::size_t n) {
+        std::size_t cap = CtrlGroup::kWidth;
+        while (cap * 7 < n * 8) cap *= 2;
+        if (cap <= cap_) cap = sz_ * 32 <= cap_ * 25 ? cap_ : cap_ * 2;
+        Array<std::int8_t> ctrlVelho = std::move(ctrl_);
+        Array<Node*> slotsVelhos = std::move(slots_);
+        const std::size_t capVelha = cap_;
+        ctrl_ = newArray<std::int8_t>(cap + CtrlGroup::kWidth);
+        slots_ = newArray<Node*>(cap);
+        cap_ = cap;
+        std::memset(ctrl_.get(), kEmpty, cap + CtrlGroup::kWidth);
+        apagados_ = 0;
+        for (std::size_t i = 0; i < capVelha; ++i) {
+            if (ctrlVelho[i] < 0) continue;
+            const std::size_t j = freeSlot(mix(slotsVelhos[i]->key));
+            setCtrl(j, ctrlVelho[i]);
+            slots_[j] = slotsVelhos[i];
+        }
+    }
+};
+
+// A BST pode usar qualquer política (Scapegoat por padrão) e o modo
+// multiset; contains/find não passam pela árvore, então no splay só
+// inserções giram. Os nós devolvidos por find valem até sua remoção.
+// Hash precisa concordar com Compare: chaves equivalentes na ordem (nem
+// a < b nem b < a) devem ter o mesmo hash. std::hash só serve com um
+// Compare que separa chaves diferentes; para ordem sem distinção de
+// maiúsculas, por exemplo, passe um Hash que também ignore a caixa. Se
+// não concordarem, insert não duplica o nó no índice, mas contains e find
+// podem não achar chaves que a árvore tem.
+template <typename T, typename Hash = std::hash<T>, typename Compare = std::less<T>>
+class HashedBST {
+public:
+    using Tree = BST<T, Compare>;
+    using Node = typename Tree::Node;
+    using const_iterator = typename Tree::const_iterator;
+
+    HashedBST() { tree_.setBalancePolicy(BalancePolicy::Scapegoat); }
+
+    HashedBST(HashedBST&&) noexcept = default;
+    HashedBST& operator=(HashedBST&&) noexcept = default;
+    HashedBST(const HashedBST&) = delete;
+    HashedBST& operator=(const HashedBST&) = delete;
+
+    HashedBST clone() const {
+        HashedBST c;
+        c.tree_ = tree_.clone();
+        c.reindex();
+        return c;
+    }
+
+    void setBalancePolicy(BalancePolicy p, double alpha = 0.7) { tree_.setBalancePolicy(p, alpha); }
+    void setMultiset(bool on) { tree_.setMultiset(on); }
+    bool multiset() const { return tree_.multiset(); }
+
+    std::size_t size() const { return tree_.size(); }
+    bool empty() const { return tree_.empty(); }
+    void clear() {
+        index_.clear();
+        tree_.clear();
+    }
+
+    // Prepara o índice para n chaves distintas
+    void reserve(std::size_t n) { index_.reserve(n); }
+
+    bool contains(const T& k) const { return index_.find(k) != nullptr; }
+    const Node* find(const T& k) const { return index_.find(k); }
+    std::size_t count(const T& k) const {
+        const Node* n = index_.find(k);
+        return n ? Tree::multiplicity(n) : 0;
+    }
+
+    // Retorna true se a chave era nova. No modo multiset, uma chave
+    // existente ganha uma ocorrência (a árvore parte do próprio nó).
+    bool insert(const T& k) {
+        if (Node* n = index_.find(k)) {
+            if (tree_.multiset()) tree_.insert(n, k);
+            return false;
+        }
+        // O índice pode errar só se Hash discordar de Compare; a árvore decide
+        auto [n, nova] = tree_.insertUnique(k, k);
+        if (!nova) {
+            if (tree_.multiset()) tree_.insert(n, k);
+            return false;
+        }
+        index_.insert(n);
+        return true;
+    }
+
+    // Remove uma ocorrência de k, a partir do nó achado no índice
+    bool remove(const T& k) { return erase(k, 1) != 0; }
+
+    // Remove até n ocorrências de k (todas, por padrão)
+    std::size_t erase(const T& k, std::size_t n = std::size_t(-1)) {
+        Node* x = index_.find(k);
+        if (!x || n == 0) return 0;
+        if (n >= Tree::multiplicity(x)) index_.erase(x);
+        return tree_.eraseAt(x, n);
+    }
+
+    // Operações ordenadas: direto na árvore
+    const_iterator begin() const { return tree_.begin(); }
+    const_iterator end() const { return tree_.end(); }
+    const_iterator lowerBound(const T& k) const { return tree_.lowerBound(k); }
+    std::vector<T> inOrder() const { return tree_.inOrder(); }
+    const Node* select(std::size_t i) const { return tree_.select(i); }
+    std::size_t rank(const T& k) const { return tree_.rank(k); }
+
+    // Chama f(chave) para cada elemento em [lo, hi)
+    template <typename F>
+    void forRange(const T& lo, const T& hi, F f) const {
+        for (const_iterator it = tree_.lowerBound(lo); it != tree_.end() && comp_(*it, hi); ++it) f(*it);
+    }
+
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m = tree_.memoryUsage();
+        m += index_.memoryUsage();
+        m.overheadBytes += sizeof(HashedBST) - sizeof(Tree) - sizeof(Index);
+        return m;
+    }
+
+    const Tree& tree() const { return tree_; }
+
+private:
+    // Igualdade derivada do Compare, para que índice e árvore concordem
+    // sobre quais chaves são a mesma
+    struct Equiv {
+        Compare comp;
+        bool operator()(const T& a, const T& b) const { return !comp(a, b) && !comp(b, a); }
+    };
+    using Index = NodeHashIndex<Node, Hash, Equiv>;
+
+    Tree tree_;
+    Index index_;
+    Compare comp_;
+
+    void reindex() {
+        index_.clear();
+        index_.reserve(tree_.distinctSize());
+        std::vector<const Node*> pilha;
+        if (tree_.root()) pilha.push_back(tree_.root());
+        while (!pilha.empty()) {
+            const Node* n = pilha.back();
+            pilha.pop_back();
+            index_.insert(const_cast<Node*>(n));
+            if (n->left) pilha.push_back(n->left);
+            if (n->right) pilha.push_back(n->right);
+        }
+    }
+};
+
+// ====================================================
+// Classe BTree (árvore B+ com nós do tamanho de linhas de cache)
+// ====================================================
+// Conjunto ordenado com a mesma interface de BST<T> (insert, remove,
+// contains, lowerBound, inOrder, iteradores, size), mas cada nó guarda
+// dezenas de chaves num vetor contíguo de ~NodeBytes bytes. Uma busca
+// toca log_B(n) nós em vez de log_2(n), e cada nó buscado aproveita
+// todas as linhas de cache que trouxe da memória.
+//
+// As chaves ficam só nas folhas; os nós internos guardam cópias que
+// servem de separadores. As folhas formam uma lista duplamente ligada,
+// então percorrer um intervalo é varrer vetores em sequência.
+//
+// T precisa ser construível por padrão e atribuível (os vetores dos nós
+// são arrays de T). Iteradores valem até a próxima inserção ou remoção.
+template <typename T, std::size_t NodeBytes = 256, typename Compare = std::less<T>>
+class BTree {
+    struct NodeBase {
+        bool leaf;
+        std::uint16_t count = 0;  // folhas: chaves; internos: separadores
+        explicit NodeBase(bool f) : leaf(f) {}
+    };
+
+    static constexpr std::size_t capacidade(std::size_t cabecalho, std::size_t porItem) {
+        return NodeBytes > cabecalho + 4 * porItem ? (NodeBytes - cabecalho) / porItem : 4;
+    }
+
+public:
+    // Chaves por folha e separadores por nó interno, derivados de NodeBytes
+    static constexpr std::size_t kLeafCap = capacidade(sizeof(NodeBase) + 2 * sizeof(void*), sizeof(T));
+    static constexpr std::size_t kInnerCap = capacidade(sizeof(NodeBase) + sizeof(void*), sizeof(T) + sizeof(void*));
+
+private:
+    static_assert(kLeafCap <= 0xFFFF && kInnerCap <= 0xFFFF, "NodeBytes grande demais");
+    static constexpr std::size_t kLeafMin = kLeafCap / 2;
+    static constexpr std::size_t kInnerMin = kInnerCap / 2;
+    static constexpr int kMaxHeight = 64;
+
+    struct alignas(64) Leaf : NodeBase, CountedAllocation {
+        Leaf() : NodeBase(true) {}
+        Leaf* next = nullptr;
+        Leaf* prev = nullptr;
+        T keys[kLeafCap];
+    };
+
+    struct alignas(64) Inner : NodeBase, CountedAllocation {
+        Inner() : NodeBase(false) {}
+        T keys[kInnerCap];
+        NodeBase* child[kInnerCap + 1];  // child[i] tem as chaves em [keys[i-1], keys[i])
+    };
+
+    // Caminho da raiz até a folha: nó interno e índice do filho seguido
+    struct Step {
+        Inner* node;
+        std::size_t idx;
+    };
+
+    NodeBase* root_ = nullptr;
+    Leaf* head_ = nullptr;  // folha mais à esquerda
+    Leaf* tail_ = nullptr;  // folha mais à direita
+    std::size_t sz_ = 0;
+    std::size_t leaves_ = 0;
+    std::size_t inners_ = 0;
+    int height_ = 0;        // níveis de nós internos acima das folhas
+    Compare comp_;
+
+    // Busca dentro do nó. Para chaves aritméticas com std::less conta
+    // quantas chaves são menores: um laço sem desvios que o compilador
+    // vetoriza. Nos demais casos, busca binária sem desvio no corpo.
+    static constexpr bool kContagem =
+        std::is_arithmetic<T>::value && std::is_same<Compare, std::less<T>>::value;
+
+    // Primeira posição com keys[i] >= x
+    std::size_t lowerIdx(const T* keys, std::size_t n, const T& x) const {
+        if constexpr (kContagem) {
+            std::size_t r = 0;
+            for (std::size_t i = 0; i < n; ++i) r += keys[i] < x;
+            return r;
+        } else {
+            const T* base = keys;
+            while (n > 1) {
+                const std::size_t metade = n / 2;
+                base = comp_(base[metade], x) ? base + metade : base;
+                n -= metade;
+            }
+            return static_cast<std::size_t>(base - keys) + (n == 1 && comp_(*base, x));
+        }
+    }
+
+    // Primeira posição com keys[i] > x (índice do filho a descer)
+    std::size_t upperIdx(const T* keys, std::size_t n, const T& x) const {
+        if constexpr (kContagem) {
+            std::size_t r = 0;
+            for (std::size_t i = 0; i < n; ++i) r += keys[i] <= x;
+            return r;
+        } else {
+            const T* base = keys;
+            while (n > 1) {
+                const std::size_t metade = n / 2;
+                base = comp_(x, base[metade]) ? base : base + metade;
+                n -= metade;
+            }
+            return static_cast<std::size_t>(base - keys) + (n == 1 && !comp_(x, *base));
+        }
+    }
+
+    static Leaf* asLeaf(NodeBase* n) { return static_cast<Leaf*>(n); }
+    static const Leaf* asLeaf(const NodeBase* n) { return static_cast<const Leaf*>(n); }
+    static Inner* asInner(NodeBase* n) { return static_cast<Inner*>(n); }
+    static const Inner* asInner(const NodeBase* n) { return static_cast<const Inner*>(n); }
+
+    Leaf* newLeaf() { Leaf* l = new Leaf(); ++leaves_; return l; }
+    Inner* newInner() { Inner* in = new Inner(); ++inners_; return in; }
+    void freeNode(NodeBase* n) {
+        if (n->leaf) { delete asLeaf(n); --leaves_; }
+        else { delete asInner(n); --inners_; }
+    }
+
+    // Desce até a folha que conteria x, anotando o caminho se pedido
+    Leaf* descend(const T& x, Step* path = nullptr) const {
+        NodeBase* n = root_;
+        int d = 0;
+        while (!n->leaf) {
+            Inner* in = asInner(n);
+            const std::size_t i = upperIdx(in->keys, in->count, x);
+            if (path) path[d++] = { in, i };
+            n = in->child[i];
+        }
+        return asLeaf(n);
+    }
+
+    // Insere (sep, right) no pai de left, subindo enquanto houver divisões
+    void insertIntoParent(Step* path, int d, NodeBase* left, T sep, NodeBase* right) {
+        while (d > 0) {
+            Inner* in = path[--d].node;
+            const std::size_t i = path[d].idx;
+            if (in->count < kInnerCap) {
+                std::move_backward(in->keys + i, in->keys + in->count, in->keys + in->count + 1);
+                std::copy_backward(in->child + i + 1, in->child + in->count + 1, in->child + in->count + 2);
+                in->keys[i] = std::move(sep);
+                in->child[i + 1] = right;
+                ++in->count;
+                return;
+            }
+            // Nó cheio: junta tudo num vetor temporário e divide ao meio;
+            // a chave do meio sobe e não fica em nenhuma das metades
+            T tk[kInnerCap + 1];
+            NodeBase* tc[kInnerCap + 2];
+            std::move(in->keys, in->keys + i, tk);
+            tk[i] = std::move(sep);
+            std::move(in->keys + i, in->keys + kInnerCap, tk + i + 1);
+            std::copy(in->child, in->child + i + 1, tc);
+            tc[i + 1] = right;
+            std::copy(in->child + i + 1, in->child + kInnerCap + 1, tc + i + 2);
+
+            const std::size_t meio = (kInnerCap + 1) / 2;
+            Inner* dir = newInner();
+            std::move(tk, tk + meio, in->keys);
+            std::copy(tc, tc + meio + 1, in->child);
+            in->count = static_cast<std::uint16_t>(meio);
+            std::move(tk + meio + 1, tk + kInnerCap + 1, dir->keys);
+            std::copy(tc + meio + 1, tc + kInnerCap + 2, dir->child);
+            dir->count = static_cast<std::uint16_t>(kInnerCap - meio);
+
+            left = in;
+            sep = std::move(tk[meio]);
+            right = dir;
+        }
+        Inner* raiz = newInner();
+        raiz->keys[0] = std::move(sep);
+        raiz->child[0] = left;
+        raiz->child[1] = right;
+        raiz->count = 1;
+        root_ = raiz;
+        ++height_;
+    }
+
+    // Remove o separador keys[i] e o filho child[i + 1] de um nó interno
+    static void eraseSeparator(Inner* in, std::size_t i) {
+        std::move(in->keys + i + 1, in->keys + in->count, in->keys + i);
+        std::copy(in->child + i + 2, in->child + in->count + 1, in->child + i + 1);
+        --in->count;
+    }
+
+    void unlinkLeaf(Leaf* l) {
+        (l->prev ? l->prev->next : head_) = l->next;
+        (l->next ? l->next->prev : tail_) = l->prev;
+    }
+
+    // Folha abaixo do mínimo: pega uma chave de um irmão ou funde com ele
+    void fixLeaf(Step* path, int d, Leaf* l) {
+        Inner* pai = path[d - 1].node;
+        const std::size_t i = path[d - 1].idx;
+        Leaf* esq = i > 0 ? asLeaf(pai->child[i - 1]) : nullptr;
+        Leaf* dir = i < pai->count ? asLeaf(pai->child[i + 1]) : nullptr;
+
+        if (esq && esq->count > kLeafMin) {
+            std::move_backward(l->keys, l->keys + l->count, l->keys + l->count + 1);
+            l->keys[0] = std::move(esq->keys[--esq->count]);
+            ++l->count;
+            pai->keys[i - 1] = l->keys[0];
+            return;
+        }
+        if (dir && dir->count > kLeafMin) {
+            l->keys[l->count++] = std::move(dir->keys[0]);
+            std::move(dir->keys + 1, dir->keys + dir->count, dir->keys);
+            --dir->count;
+            pai->keys[i] = dir->keys[0];
+            return;
+        }
+        // Fusão: a folha da direita é esvaziada na da esquerda
+        Leaf* a = esq ? esq : l;
+        Leaf* b = esq ? l : dir;
+        std::move(b->keys, b->keys + b->count, a->keys + a->count);
+        a->count = static_cast<std::uint16_t>(a->count + b->count);
+        unlinkLeaf(b);
+        freeNode(b);
+        eraseSeparator(pai, esq ? i - 1 : i);
+        fixInner(path, d - 1);
+    }
+
+    // Nó interno path[d] possivelmente abaixo do mínimo
+    void fixInner(Step* path, int d) {
+        Inner* n = path[d].node;
+        if (d == 0) {
+            if (n->count == 0) {  // raiz sem separadores: o único filho sobe
+                root_ = n->child[0];
+                freeNode(n);
+                --height_;
+            }
+            return;
+        }
+        if (n->count >= kInnerMin) return;
+
+        Inner* pai = path[d - 1].node;
+        const std::size_t i = path[d - 1].idx;
+        Inner* esq = i > 0 ? asInner(pai->child[i - 1]) : nullptr;
+        Inner* dir = i < pai->count ? asInner(pai->child[i + 1]) : nullptr;
+
+        if (esq && esq->count > kInnerMin) {  // rotação à direita pelo pai
+            std::move_backward(n->keys, n->keys + n->count, n->keys + n->count + 1);
+            std::copy_backward(n->child, n->child + n->count + 1, n->child + n->count + 2);
+            n->keys[0] = std::move(pai->keys[i - 1]);
+            n->child[0] = esq->child[esq->count];
+            pai->keys[i - 1] = std::move(esq->keys[esq->count - 1]);
+            --esq->count;
+            ++n->count;
+            return;
+        }
+        if (dir && dir->count > kInnerMin) {  // rotação à esquerda pelo pai
+            n->keys[n->count] = std::move(pai->keys[i]);
+            n->child[n->count + 1] = dir->child[0];
+            ++n->count;
+            pai->keys[i] = std::move(dir->keys[0]);
+            std::move(dir->keys + 1, dir->keys + dir->count, dir->keys);
+            std::copy(dir->child + 1, dir->child + dir->count + 1, dir->child);
+            --dir->count;
+            return;
+        }
+        // Fusão: separador do pai desce entre as duas metades
+        Inner* a = esq ? esq : n;
+        Inner* b = esq ? n : dir;
+        const std::size_t s = esq ? i - 1 : i;
+        a->keys[a->count] = std::move(pai->keys[s]);
+        std::move(b->keys, b->keys + b->count, a->keys + a->count + 1);
+        std::copy(b->child, b->child + b->count + 1, a->child + a->count + 1);
+        a->count = static_cast<std::uint16_t>(a->count + 1 + b->count);
+        freeNode(b);
+        eraseSeparator(pai, s);
+        fixInner(path, d - 1);
+    }
+
+    void destroy(NodeBase* n) {
+        if (!n->leaf) {
+            Inner* in = asInner(n);
+            for (std::size_t i = 0; i <= in->count; ++i) destroy(in->child[i]);
+        }
+        freeNode(n);
+    }
+
+    void stealFrom(BTree& o) {
+        root_ = o.root_; head_ = o.head_; tail_ = o.tail_;
+        sz_ = o.sz_; leaves_ = o.leaves_; inners_ = o.inners_; height_ = o.height_;
+        o.root_ = nullptr; o.head_ = o.tail_ = nullptr;
+        o.sz_ = o.leaves_ = o.inners_ = 0; o.height_ = 0;
+    }
+
+public:
+    BTree() = default;
+    explicit BTree(const Compare& comp) : comp_(comp) {}
+    ~BTree() { clear(); }
+
+    BTree(const BTree&) = delete;
+    BTree& operator=(const BTree&) = delete;
+
+    BTree(BTree&& o) noexcept : comp_(o.comp_) { stealFrom(o); }
+    BTree& operator=(BTree&& o) noexcept {
+        if (this != &o) {
+            clear();
+            comp_ = o.comp_;
+            stealFrom(o);
+        }
+        return *this;
+    }
+
+    // Iterador em ordem (somente leitura) que anda pela lista de folhas
+    class const_iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() : l_(nullptr), i_(0), t_(nullptr) {}
+
+        reference operator*() const { return l_->keys[i_]; }
+        pointer operator->() const { return &l_->keys[i_]; }
+
+        const_iterator& operator++() {
+            if (++i_ == l_->count) { l_ = l_->next; i_ = 0; }
+            return *this;
+        }
+        const_iterator operator++(int) { const_iterator c = *this; ++*this; return c; }
+        const_iterator& operator--() {
+            if (!l_) { l_ = t_->tail_; i_ = l_->count - 1u; }
+            else if (i_ == 0) { l_ = l_->prev; i_ = l_->count - 1u; }
+            else --i_;
+            return *this;
+        }
+        const_iterator operator--(int) { const_iterator c = *this; --*this; return c; }
+
+        bool operator==(const const_iterator& o) const { return l_ == o.l_ && i_ == o.i_; }
+        bool operator!=(const const_iterator& o) const { return !(*this == o); }
+
+    private:
+        friend class BTree;
+        const_iterator(const Leaf* l, std::size_t i, const BTree* t) : l_(l), i_(i), t_(t) {}
+        const Leaf* l_;
+        std::size_t i_;
+        const BTree* t_;
+    };
+    using iterator = const_iterator;
+
+    const_iterator begin() const { return const_iterator(head_, 0, this); }
+    const_iterator end() const { return const_iterator(nullptr, 0, this); }
+
+    // Primeiro elemento com chave >= k
+    const_iterator lowerBound(const T& k) const {
+        if (!root_) return end();
+        const Leaf* l = descend(k);
+        const std::size_t i = lowerIdx(l->keys, l->count, k);
+        if (i < l->count) return const_iterator(l, i, this);
+        return const_iterator(l->next, 0, this);
+    }
+
+    const_iterator find(const T& k) const {
+        const_iterator it = lowerBound(k);
+        return (it != end() && !comp_(k, *it)) ? it : end();
+    }
+
+    bool contains(const T& k) const {
+        if (!root_) return false;
+        const Leaf* l = descend(k);
+        const std::size_t i = lowerIdx(l->keys, l->count, k);
+        return i < l->count && !comp_(k, l->keys[i]);
+    }
+
+    // Retorna false se a chave já existia
+    bool insert(const T& x) {
+        if (!root_) {
+            Leaf* l = newLeaf();
+            l->keys[0] = x;
+            l->count = 1;
+            root_ = head_ = tail_ = l;
+            sz_ = 1;
+            return true;
+        }
+        Step path[kMaxHeight];
+        Leaf* l = descend(x, path);
+        const std::size_t pos = lowerIdx(l->keys, l->count, x);
+        if (pos < l->count && !comp_(x, l->keys[pos])) return false;
+        ++sz_;
+
+        if (l->count < kLeafCap) {
+            std::move_backward(l->keys + pos, l->keys + l->count, l->keys + l->count + 1);
+            l->keys[pos] = x;
+            ++l->count;
+            return true;
+        }
+
+        // Folha cheia: metade de cima vai para uma folha nova à direita
+        const std::size_t meio = kLeafCap / 2;
+        Leaf* dir = newLeaf();
+        std::move(l->keys + meio, l->keys + kLeafCap, dir->keys);
+        dir->count = static_cast<std::uint16_t>(kLeafCap - meio);
+        l->count = static_cast<std::uint16_t>(meio);
+        Leaf* alvo = pos <= meio ? l : dir;
+        const std::size_t p = pos <= meio ? pos : pos - meio;
+        std::move_backward(alvo->keys + p, alvo->keys + alvo->count, alvo->keys + alvo->count + 1);
+        alvo->keys[p] = x;
+        ++alvo->count;
+
+        dir->next = l->next;
+        dir->prev = l;
+        (l->next ? l->next->prev : tail_) = dir;
+        l->next = dir;
+
+        insertIntoParent(path, height_, l, dir->keys[0], dir);
+        return true;
+    }
+
+    // Retorna false se a chave não existia
+    bool remove(const T& x) {
+        if (!root_) return false;
+        Step path[kMaxHeight];
+        Leaf* l = descend(x, path);
+        const std::size_t pos = lowerIdx(l->keys, l->count, x);
+        if (pos == l->count || comp_(x, l->keys[pos])) return false;
+
+        std::move(l->keys + pos + 1, l->keys + l->count, l->keys + pos);
+        --l->count;
+        --sz_;
+        if (height_ == 0) {
+            if (l->count == 0) {
+                freeNode(l);
+                root_ = nullptr;
+                head_ = tail_ = nullptr;
+            }
+            return true;
+        }
+        if (l->count < kLeafMin) fixLeaf(path, height_, l);
+        return true;
+    }
+
+    void clear() {
+        if (root_) destroy(root_);
+        root_ = nullptr;
+        head_ = tail_ = nullptr;
+        sz_ = 0;
+        height_ = 0;
+    }
+
+    // Chama f(chave) para cada chave em [lo, hi), varrendo as folhas em sequência
+    template <typename F>
+    void forRange(const T& lo, const T& hi, F f) const {
+        if (!root_) return;
+        const Leaf* l = descend(lo);
+        std::size_t i = lowerIdx(l->keys, l->count, lo);
+        for (; l; l = l->next, i = 0) {
+            for (; i < l->count; ++i) {
+                if (!comp_(l->keys[i], hi)) return;
+                f(l->keys[i]);
+            }
+        }
+    }
+
+    std::vector<T> inOrder() const {
+        std::vector<T> out;
+        out.reserve(sz_);
+        for (const Leaf* l = head_; l; l = l->next) out.insert(out.end(), l->keys, l->keys + l->count);
+        return out;
+    }
+
+    std::size_t size() const { return sz_; }
+    bool empty() const { return sz_ == 0; }
+    int height() const { return root_ ? height_ + 1 : 0; }
+    const Compare& keyComp() const { return comp_; }
+
+    // Entrada de layout no mesmo formato de BST::LayoutEntry (x e y em 0..1,
+    // depth a partir da raiz), com um nó desenhado por nó da árvore B+.
+    // keys aponta para as count chaves do nó; parent é o índice do pai
+    // no vetor devolvido (-1 na raiz), para desenhar as arestas.
+    struct LayoutEntry {
+        const void* node;
+        double x;
+        double y;
+        int depth;
+        int parent;
+        const T* keys;
+        std::size_t count;
+    };
+
+    // Folhas igualmente espaçadas em x; cada nó interno fica no meio do
+    // intervalo ocupado pelos seus filhos. Saída em ordem de níveis.
+    std::vector<LayoutEntry> layoutNormalized() const {
+        std::vector<LayoutEntry> out;
+        if (!root_) return out;
+        std::vector<std::size_t> primeiroFilho;  // índice do primeiro filho em out
+        out.push_back({ root_, 0.0, 0.0, 0, -1, nullptr, 0 });
+        for (std::size_t k = 0; k < out.size(); ++k) {
+            const NodeBase* n = static_cast<const NodeBase*>(out[k].node);
+            primeiroFilho.push_back(out.size());
+            if (n->leaf) {
+                out[k].keys = asLeaf(n)->keys;
+                out[k].count = n->count;
+                continue;
+            }
+            const Inner* in = asInner(n);
+            out[k].keys = in->keys;
+            out[k].count = in->count;
+            for (std::size_t c = 0; c <= in->count; ++c)
+                out.push_back({ in->child[c], 0.0, 0.0, out[k].depth + 1, static_cast<int>(k), nullptr, 0 });
+        }
+        const double denomY = height_ == 0 ? 1.0 : static_cast<double>(height_);
+        std::size_t folha = 0;
+        for (auto& e : out) {
+            if (e.depth == height_) e.x = static_cast<double>(++folha) / static_cast<double>(leaves_ + 1);
+            e.y = height_ == 0 ? 0.0 : e.depth / denomY;
+        }
+        // Ordem de níveis invertida: os filhos já têm x quando o pai é visitado
+        for (std::size_t k = out.size(); k-- > 0;) {
+            if (out[k].depth == height_) continue;
+            const std::size_t f = primeiroFilho[k];
+            out[k].x = (out[f].x + out[f + out[k].count].x) / 2.0;
+        }
+        return out;
+    }
+
+    // Memória ocupada: um bloco de heap por nó, com as posições vagas dos
+    // vetores contadas como estrutura
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m;
+        accountElements<T>(sz_, m, [&] { for (const T& k : *this) accountPayload(k, m); });
+        const std::size_t bytesNos = leaves_ * sizeof(Leaf) + inners_ * sizeof(Inner);
+        m.overheadBytes += sizeof(BTree) + bytesNos - sz_ * sizeof(T);
+        m.addBlock(sizeof(Leaf), leaves_);
+        m.addBlock(sizeof(Inner), inners_);
+        return m;
+    }
+};
+
+// ====================================================
+// Classe StaticOrderedSet (conjunto ordenado em tempo de compilação)
+// ====================================================
+// Para tabelas fixas (opcodes, IDs reservados): as chaves vêm como
+// parâmetros do template e são ordenadas, sem duplicatas, e dispostas em
+// ordem de Eytzinger (árvore completa implícita num array: filhos de k em
+// 2k e 2k+1) durante a compilação. Nada é feito na inicialização do
+// programa e nada vai para o heap.
+//
+//     using Reservados = StaticOrderedSet<int, 7, 3, 42, 3, 0>;
+//     static_assert(Reservados::contains(42), "");
+//     Reservados::size();  // 4
+//
+// A descida é sem desvios (o índice avança com k = 2k + (chave < x)) e
+// tem exatamente kDepth passos, desenrolados por um fold expression. A
+// árvore é completada até 2^kDepth - 1 posições repetindo a maior chave,
+// que se comporta como "+infinito" à direita das chaves reais.
+// As chaves precisam ser valores constantes de tipo inteiro ou enum, e a
+// ordem é a de operator<.
+
+template <typename T, T... Keys>
+class StaticOrderedSet {
+    static constexpr std::size_t kRaw = sizeof...(Keys);
+
+    // Ordenação por inserção: constexpr em C++17 e de sobra para tabelas
+    static constexpr std::array<T, kRaw> sortedKeys() {
+        std::array<T, kRaw> a{ { Keys... } };
+        for (std::size_t i = 1; i < kRaw; ++i) {
+            const T x = a[i];
+            std::size_t j = i;
+            for (; j > 0 && x < a[j - 1]; --j) a[j] = a[j - 1];
+            a[j] = x;
+        }
+        return a;
+    }
+
+    static constexpr std::array<T, kRaw> kSortedRaw = sortedKeys();
+
+    static constexpr std::size_t countUnique() {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < kRaw; ++i) {
+            if (i == 0 || kSortedRaw[i - 1] < kSortedRaw[i]) ++n;
+        }
+        return n;
+    }
+
+public:
+    static constexpr std::size_t kSize = countUnique();
+
+private:
+    static constexpr std::size_t depthFor(std::size_t n) {
+        std::size_t d = 0;
+        while ((std::size_t(1) << d) - 1 < n) ++d;
+        return d;
+    }
+
+    static constexpr std::size_t kDepth = depthFor(kSize);
+    static constexpr std::size_t kFull = (std::size_t(1) << kDepth) - 1;
+
+    static constexpr std::array<T, kSize> uniqueKeys() {
+        std::array<T, kSize> u{};
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < kRaw; ++i) {
+            if (i == 0 || kSortedRaw[i - 1] < kSortedRaw[i]) u[n++] = kSortedRaw[i];
+        }
+        return u;
+    }
+
+    static constexpr std::array<T, kSize> kSorted = uniqueKeys();
+
+    // Posição 0 sem uso; ranks[k] é a posição em ordem do índice k
+    struct Layout {
+        std::array<T, kFull + 1> keys{};
+        std::array<std::size_t, kFull + 1> ranks{};
+    };
+
+    // Percorre a árvore implícita em ordem (sem recursão, subindo por k/2)
+    // atribuindo a i-ésima chave ordenada ao i-ésimo índice visitado
+    static constexpr Layout buildLayout() {
+        Layout l{};
+        if (kFull == 0) return l;
+        std::size_t k = 1;
+        while (2 * k <= kFull) k = 2 * k;
+        for (std::size_t r = 0; r < kFull; ++r) {
+            l.keys[k] = r < kSize ? kSorted[r] : kSorted[kSize - 1];
+            l.ranks[k] = r;
+            if (2 * k + 1 <= kFull) {
+                k = 2 * k + 1;
+                while (2 * k <= kFull) k = 2 * k;
+            } else {
+                while (k & 1) k >>= 1; // sobe enquanto vem da direita
+                k >>= 1;
+            }
+        }
+        return l;
+    }
+
+    static constexpr Layout kLayout = buildLayout();
+
+    template <std::size_t... Passo>
+    static constexpr std::size_t descend(const T& x, std::index_sequence<Passo...>) {
+        std::size_t k = 1;
+        ((static_cast<void>(Passo), k = 2 * k + static_cast<std::size_t>(kLayout.keys[k] < x)), ...);
+        return k;
+    }
+
+    // Posição em ordem da primeira chave >= x (kSize se não houver)
+    static constexpr std::size_t lowerRank(const T& x) {
+        if (kSize == 0) return 0;
+        std::size_t k = descend(x, std::make_index_sequence<kDepth>{});
+        // Desfaz os passos à direita finais: o último passo à esquerda
+        // marca o menor elemento >= x
+#if defined(__GNUC__)
+        k >>= __builtin_ctzll(~static_cast<unsigned long long>(k)) + 1;
+#else
+        while (k & 1) k >>= 1;
+        k >>= 1;
+#endif
+        return k == 0 ? kSize : kLayout.ranks[k];
+    }
+
+public:
+    using const_iterator = const T*;
+    using iterator = const_iterator;
+
+    static constexpr std::size_t size() { return kSize; }
+    static constexpr bool empty() { return kSize == 0; }
+    static constexpr std::less<T> keyComp() { return std::less<T>(); }
+
+    static constexpr const_iterator begin() { return kSorted.data(); }
+    static constexpr const_iterator end() { return kSorted.data() + kSize; }
+
+    // Primeiro elemento com chave >= k
+    static constexpr const_iterator lowerBound(const T& k) {
+        return begin() + lowerRank(k);
+    }
+
+    static constexpr bool contains(const T& k) {
+        const std::size_t r = lowerRank(k);
+        return r < kSize && !(k < kSorted[r]);
+    }
+
+    // Ponteiro para a chave guardada (nullptr se não existir)
+    static constexpr const T* find(const T& k) {
+        return contains(k) ? begin() + lowerRank(k) : nullptr;
+    }
+
+    static std::vector<T> inOrder() { return std::vector<T>(begin(), end()); }
+};
+
+// ====================================================
+// Classe IntrusiveBST (BST intrusiva)
+// ====================================================
+// Como as listas intrusivas: o objeto herda TreeHook e é ligado à árvore
+// sem alocação nem cópia. A remoção usa as mesmas ligações da BST
+// (treeUnlink/treeTransplant). Compare ordena os próprios objetos; buscas
+// aceitam qualquer chave que Compare saiba comparar com T (por exemplo um
+// comparador transparente com sobrecargas para (T, int) e (int, T)).
+
+template <typename Tag = void>
+class TreeHook {
+public:
+    TreeHook() = default;
+    TreeHook(const TreeHook&) {}
+    TreeHook& operator=(const TreeHook&) { return *this; }
+
+    bool isLinked() const { return linked_; }
+
+private:
+    template <typename T, typename C, typename G> friend class IntrusiveBST;
+    template <typename N> friend N* treeMinimum(N*);
+    template <typename N> friend N* treeMaximum(N*);
+    template <typename N> friend N* treeSuccessor(N*);
+    template <typename N> friend N* treePredecessor(N*);
+    template <typename N> friend void treeTransplant(N*&, N*, N*);
+    template <typename N> friend void treeUnlink(N*&, N*);
+
+    TreeHook* left = nullptr;
+    TreeHook* right = nullptr;
+    TreeHook* parent = nullptr;
+    bool linked_ = false; // a raiz não tem pai, então o estado fica explícito
+};
+
+template <typename T, typename Compare = std::less<T>, typename Tag = void>
+class IntrusiveBST {
+    using Hook = TreeHook<Tag>;
+
+    Hook* root_ = nullptr;
+    std::size_t sz_ = 0;
+    Compare comp_;
+
+    static Hook* hookOf(const T& x) { return const_cast<Hook*>(static_cast<const Hook*>(&x)); }
+    static T& objectOf(Hook* h) { return static_cast<T&>(*h); }
+
+    template <typename K>
+    Hook* findHook(const K& k) const {
+        Hook* cur = root_;
+        while (cur) {
+            if (comp_(k, objectOf(cur))) cur = cur->left;
+            else if (comp_(objectOf(cur), k)) cur = cur->right;
+            else return cur;
+        }
+        return nullptr;
+    }
+
+    void resetHook(Hook* h) {
+        h->left = h->right = h->parent = nullptr;
+        h->linked_ = false;
+    }
+
+public:
+    IntrusiveBST() = default;
+    explicit IntrusiveBST(const Compare& comp) : comp_(comp) {}
+    ~IntrusiveBST() { clear(); }
+
+    IntrusiveBST(const IntrusiveBST&) = delete;
+    IntrusiveBST& operator=(const IntrusiveBST&) = delete;
+
+    // Iterador em ordem, apoiado nos ponteiros parent dos hooks
+    class iterator {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T*;
+        using reference = T&;
+
+        iterator() : h_(nullptr), t_(nullptr) {}
+        reference operator*() const { return objectOf(h_); }
+        pointer operator->() const { return &objectOf(h_); }
+        iterator& operator++() { h_ = treeSuccessor(h_); return *this; }
+        iterator operator++(int) { iterator c = *this; ++*this; return c; }
+        iterator& operator--() { h_ = h_ ? treePredecessor(h_) : treeMaximum(t_->root_); return *this; }
+        iterator operator--(int) { iterator c = *this; --*this; return c; }
+        bool operator==(const iterator& o) const { return h_ == o.h_; }
+        bool operator!=(const iterator& o) const { return h_ != o.h_; }
+
+    private:
+        friend class IntrusiveBST;
+        iterator(Hook* h, const IntrusiveBST* t) : h_(h), t_(t) {}
+        Hook* h_;
+        const IntrusiveBST* t_;
+    };
+
+    iterator begin() const { return iterator(treeMinimum(root_), this); }
+    iterator end() const { return iterator(nullptr, this); }
+
+    std::size_t size() const { return sz_; }
+    bool empty() const { return sz_ == 0; }
+    const Compare& keyComp() const { return comp_; }
+
+    // Liga x à árvore. Se já existir objeto equivalente, x fica desligado
+    // e o existente é devolvido com false.
+    std::pair<T*, bool> insert(T& x) {
+        Hook* h = hookOf(x);
+        if (h->isLinked()) throw std::invalid_argument("Objeto já está numa árvore");
+        Hook* parent = nullptr;
+        Hook* cur = root_;
+        bool esquerda = false;
+        while (cur) {
+            parent = cur;
+            if (comp_(x, objectOf(cur))) { cur = cur->left; esquerda = true; }
+            else if (comp_(objectOf(cur), x)) { cur = cur->right; esquerda = false; }
+            else return { &objectOf(cur), false };
+        }
+        h->parent = parent;
+        h->left = h->right = nullptr;
+        h->linked_ = true;
+        if (!parent) root_ = h;
+        else if (esquerda) parent->left = h;
+        else parent->right = h;
+        ++sz_;
+        return { &x, true };
+    }
+
+    template <typename K>
+    T* find(const K& k) const {
+        Hook* h = findHook(k);
+        return h ? &objectOf(h) : nullptr;
+    }
+
+    template <typename K>
+    bool contains(const K& k) const { return findHook(k) != nullptr; }
+
+    // Primeiro objeto com chave >= k
+    template <typename K>
+    iterator lowerBound(const K& k) const {
+        Hook* cur = root_;
+        Hook* res = nullptr;
+        while (cur) {
+            if (comp_(objectOf(cur), k)) cur = cur->right;
+            else { res = cur; cur = cur->left; }
+        }
+        return iterator(res, this);
+    }
+
+    // Desliga x (que precisa estar nesta árvore) sem busca
+    void erase(T& x) {
+        Hook* h = hookOf(x);
+        treeUnlink(root_, h);
+        resetHook(h);
+        --sz_;
+    }
+
+    // Desliga o objeto com chave k e o devolve (nullptr se não existir)
+    template <typename K>
+    T* remove(const K& k) {
+        Hook* h = findHook(k);
+        if (!h) return nullptr;
+        T& x = objectOf(h);
+        erase(x);
+        return &x;
+    }
+
+    // Desliga todos os objetos sem destruí-los
+    void clear() {
+        clear([](T&) {});
+    }
+
+    // Desliga todos (sem recursão, em pós-ordem) e entrega cada um,
+    // já desligado, a `descarte`
+    template <typename Disposer>
+    void clear(Disposer descarte) {
+        Hook* n = root_;
+        root_ = nullptr;
+        sz_ = 0;
+        while (n) {
+            if (n->left) n = n->left;
+            else if (n->right) n = n->right;
+            else {
+                Hook* p = n->parent;
+                if (p) (p->left == n ? p->left : p->right) = nullptr;
+                resetHook(n);
+                descarte(objectOf(n));
+                n = p;
+            }
+        }
+    }
+
+    std::vector<T*> inOrder() const {
+        std::vector<T*> out;
+        out.reserve(sz_);
+        for (Hook* h = treeMinimum(root_); h; h = treeSuccessor(h)) out.push_back(&objectOf(h));
+        return out;
+    }
+
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m;
+        m.overheadBytes += sizeof(IntrusiveBST);
+        return m;
+    }
+};
+
+// ===============================================
+// Classe PersistentBST (BST persistente / MVCC)
+// ===============================================
+// Cada versão da árvore é imutável. insert/remove copiam só o caminho
+// alterado (O(log n) nós esperados, balanceamento por treap) e publicam a
+// nova versão atomicamente. Leitores pegam um snapshot() e o consultam sem
+// nenhuma trava; versões antigas são liberadas por contagem de referências
+// quando o último snapshot que as enxerga é destruído.
+
+template <typename T, typename Compare = std::less<T>>
+class PersistentBST {
+public:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    struct Node {
+        T key;
+        std::uint32_t priority; // prioridade do treap (heap máximo)
+        NodePtr left;
+        NodePtr right;
+        Node(const T& k, std::uint32_t p, NodePtr l, NodePtr r)
+            : key(k), priority(p), left(std::move(l)), right(std::move(r)) {}
+    };
+
+private:
+    // Raiz + tamanho publicados juntos para que o snapshot seja consistente
+    struct Version {
+        NodePtr root;
+        std::size_t size;
+    };
+    using VersionPtr = std::shared_ptr<const Version>;
+
+public:
+    // Visão imutável de uma versão; válida enquanto o objeto existir
+    class Snapshot {
+    public:
+        const Node* root() const { return v_->root.get(); }
+        std::size_t size() const { return v_->size; }
+        bool empty() const { return v_->size == 0; }
+
+        bool contains(const T& k) const {
+            const Node* cur = v_->root.get();
+            while (cur) {
+                if (comp_(k, cur->key)) cur = cur->left.get();
+                else if (comp_(cur->key, k)) cur = cur->right.get();
+                else return true;
+            }
+            return false;
+        }
+
+        std::vector<T> inOrder() const {
+            std::vector<T> out;
+            out.reserve(v_->size);
+            std::vector<const Node*> pilha;
+            const Node* n = v_->root.get();
+            while (n || !pilha.empty()) {
+                while (n) { pilha.push_back(n); n = n->left.get(); }
+                n = pilha.back();
+                pilha.pop_back();
+                out.push_back(n->key);
+                n = n->right.get();
+            }
+            return out;
+        }
+
+    private:
+        friend class PersistentBST;
+        Snapshot(VersionPtr v, const Compare& c) : v_(std::move(v)), comp_(c) {}
+        VersionPtr v_;
+        Compare comp_;
+    };
+
+    PersistentBST() : PersistentBST(Compare()) {}
+    explicit PersistentBST(const Compare& comp)
+        : current_(std::allocate_shared<const Version>(CountingAllocator<Version>(), Version{ nullptr, 0 })),
+          comp_(comp), rng_(std::random_device{}()) {}
+
+    PersistentBST(const PersistentBST&) = delete;
+    PersistentBST& operator=(const PersistentBST&) = delete;
+
+    // Leitura sem trava: apenas um atomic_load do ponteiro da versão atual
+    Snapshot snapshot() const { return Snapshot(std::atomic_load(&current_), comp_); }
+
+    std::size_t size() const { return snapshot().size(); }
+    bool empty() const { return size() == 0; }
+    bool contains(const T& k) const { return snapshot().contains(k); }
+    std::vector<T> inOrder() const { return snapshot().inOrder(); }
+
+    // Escritores são serializados entre si; leitores nunca esperam
+    bool insert(const T& k) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        VersionPtr v = std::atomic_load(&current_);
+        if (Snapshot(v, comp_).contains(k)) return false;
+        NodePtr raiz = insertRec(v->root, k, static_cast<std::uint32_t>(rng_()));
+        publish(std::move(raiz), v->size + 1);
+        return true;
+    }
+
+    bool remove(const T& k) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        VersionPtr v = std::atomic_load(&current_);
+        if (!Snapshot(v, comp_).contains(k)) return false;
+        publish(removeRec(v->root, k), v->size - 1);
+        return true;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        publish(nullptr, 0);
+    }
+
+    // Memória da versão atual. Nós compartilhados com snapshots antigos
+    // também contam aqui. Cada nó vive num bloco de allocate_shared junto com
+    // o bloco de controle (estimado como vtable + dois contadores).
+    MemoryUsage memoryUsage() const {
+        Snapshot snap = snapshot();
+        const std::size_t bloco = sizeof(Node) + sizeof(void*) + 2 * sizeof(int);
+        MemoryUsage m;
+        std::vector<const Node*> pilha;
+        if (snap.root()) pilha.push_back(snap.root());
+        while (!pilha.empty()) {
+            const Node* n = pilha.back();
+            pilha.pop_back();
+            accountPayload(n->key, m);
+            if (n->left) pilha.push_back(n->left.get());
+            if (n->right) pilha.push_back(n->right.get());
+        }
+        m.overheadBytes += sizeof(PersistentBST) + snap.size() * (bloco - sizeof(T));
+        m.addBlock(bloco, snap.size());
+        m.overheadBytes += sizeof(Version) + sizeof(void*) + 2 * sizeof(int);
+        m.addBlock(sizeof(Version) + sizeof(void*) + 2 * sizeof(int));
+        return m;
+    }
+
+private:
+    VersionPtr current_; // acessado somente via std::atomic_load/atomic_store
+    Compare comp_;
+    std::mutex writeMutex_;
+    std::mt19937 rng_;
+
+    void publish(NodePtr raiz, std::size_t sz) {
+        std::atomic_store(&current_, std::allocate_shared<const Version>(CountingAllocator<Version>(), Version{ std::move(raiz), sz }));
+    }
+
+    static NodePtr make(const T& k, std::uint32_t p, NodePtr l, NodePtr r) {
+        return std::allocate_shared<const Node>(CountingAllocator<Node>(), k, p, std::move(l), std::move(r));
+    }
+
+    // Divide t em (< k, >= k) copiando apenas o caminho percorrido
+    std::pair<NodePtr, NodePtr> splitRec(const NodePtr& t, const T& k) const {
+        if (!t) return { nullptr, nullptr };
+        if (comp_(t->key, k)) {
+            auto r = splitRec(t->right, k);
+            return { make(t->key, t->priority, t->left, std::move(r.first)), std::move(r.second) };
+        }
+        auto l = splitRec(t->left, k);
+        return { std::move(l.first), make(t->key, t->priority, std::move(l.second), t->right) };
+    }
+
+    // Junta a e b (toda chave de a < toda chave de b)
+    static NodePtr mergeRec(const NodePtr& a, const NodePtr& b) {
+        if (!a) return b;
+        if (!b) return a;
+        if (a->priority > b->priority) return make(a->key, a->priority, a->left, mergeRec(a->right, b));
+        return make(b->key, b->priority, mergeRec(a, b->left), b->right);
+    }
+
+    NodePtr insertRec(const NodePtr& t, const T& k, std::uint32_t p) const {
+        if (!t || p > t->priority) {
+            auto partes = splitRec(t, k);
+            return make(k, p, std::move(partes.first), std::move(partes.second));
+        }
+        if (comp_(k, t->key)) return make(t->key, t->priority, insertRec(t->left, k, p), t->right);
+        return make(t->key, t->priority, t->left, insertRec(t->right, k, p));
+    }
+
+    NodePtr removeRec(const NodePtr& t, const T& k) const {
+        if (comp_(k, t->key)) return make(t->key, t->priority, removeRec(t->left, k), t->right);
+        if (comp_(t->key, k)) return make(t->key, t->priority, t->left, removeRec(t->right, k));
+        return mergeRec(t->left, t->right);
+    }
+};
+
+// =============================================
+// EpochDomain (recuperação de memória por épocas)
+// =============================================
+// Estruturas lock-free não podem liberar um nó assim que ele é removido:
+// outra thread pode estar lendo-o. Cada thread anuncia a época global ao
+// entrar numa seção crítica (EpochGuard); um nó aposentado na época e só é
+// liberado quando a época global chega a e + 2, isto é, quando toda thread
+// ativa já passou por uma época posterior à remoção.
+
+class EpochDomain {
+public:
+    static EpochDomain& instance() {
+        static EpochDomain d;
+        return d;
+    }
+
+    ~EpochDomain() {
+        for (auto& r : orphans_) r.del(r.p);
+    }
+
+    void enter() {
+        ThreadState& ts = local();
+        if (ts.depth++ > 0) return;
+        if (!ts.slot) ts.slot = acquireSlot();
+        // Repete se a época mudou entre a leitura e o anúncio
+        while (true) {
+            const std::uint64_t e = global_.load();
+            ts.slot->epoch.store(e);
+            if (global_.load() == e) break;
+        }
+    }
+
+    void exit() {
+        ThreadState& ts = local();
+        if (--ts.depth == 0) ts.slot->epoch.store(kIdle);
+    }
+
+    // Agenda p para ser liberado com del(p) quando nenhuma thread puder vê-lo
+    void retire(void* p, void (*del)(void*)) {
+        ThreadState& ts = local();
+        ts.limbo.push_back(Retired{ p, del, global_.load() });
+        if (ts.limbo.size() >= kReclaimBatch) {
+            tryAdvance();
+            reclaim(ts.limbo);
+            if (orphanMutex_.try_lock()) {
+                reclaim(orphans_);
+                orphanMutex_.unlock();
+            }
+        }
+    }
+
+private:
+    static constexpr std::size_t kMaxThreads = 256;
+    static constexpr std::size_t kReclaimBatch = 64;
+    static constexpr std::uint64_t kIdle = ~std::uint64_t(0);
+
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> epoch{ kIdle };
+        std::atomic<bool> used{ false };
+    };
+
+    struct Retired {
+        void* p;
+        void (*del)(void*);
+        std::uint64_t epoch;
+    };
+
+    // Estado por thread; ao terminar a thread, o que sobrou vira órfão
+    struct ThreadState {
+        Slot* slot = nullptr;
+        unsigned depth = 0;
+        std::vector<Retired> limbo;
+
+        ~ThreadState() {
+            EpochDomain& d = EpochDomain::instance();
+            {
+                std::lock_guard<std::mutex> lock(d.orphanMutex_);
+                d.orphans_.insert(d.orphans_.end(), limbo.begin(), limbo.end());
+            }
+            if (slot) slot->used.store(false);
+        }
+    };
+
+    EpochDomain() = default;
+
+    static ThreadState& local() {
+        thread_local ThreadState ts;
+        return ts;
+    }
+
+    Slot* acquireSlot() {
+        for (auto& s : slots_) {
+            bool livre = false;
+            if (s.used.compare_exchange_strong(livre, true)) return &s;
+        }
+        throw std::runtime_error("EpochDomain: threads demais");
+    }
+
+    // Avança a época se todas as threads ativas já estão na época atual
+    void tryAdvance() {
+        std::uint64_t e = global_.load();
+        for (auto& s : slots_) {
+            if (!s.used.load()) continue;
+            const std::uint64_t local = s.epoch.load();
+            if (local != kIdle && local != e) return;
+        }
+        global_.compare_exchange_strong(e, e + 1);
+    }
+
+    void reclaim(std::vector<Retired>& lista) {
+        const std::uint64_t g = global_.load();
+        std::size_t keep = 0;
+        for (std::size_t i = 0; i < lista.size(); ++i) {
+            if (lista[i].epoch + 2 <= g) lista[i].del(lista[i].p);
+            else lista[keep++] = lista[i];
+        }
+        lista.resize(keep);
+    }
+
+    std::atomic<std::uint64_t> global_{ 0 };
+    Slot slots_[kMaxThreads];
+    std::mutex orphanMutex_;
+    std::vector<Retired> orphans_;
+};
+
+// Seção crítica RAII: enquanto existir, nós lidos não são liberados.
+// Pertence à thread que o criou e pode ser aninhado.
+class EpochGuard {
+public:
+    EpochGuard() { EpochDomain::instance().enter(); }
+    EpochGuard(const EpochGuard&) { EpochDomain::instance().enter(); }
+    EpochGuard& operator=(const EpochGuard&) { return *this; }
+    ~EpochGuard() { EpochDomain::instance().exit(); }
+};
+
+// ==========================================================
+// Classe ConcurrentSkipList (conjunto ordenado lock-free)
+// ==========================================================
+// Skip list lock-free (Herlihy & Shavit / Fraser) com a mesma superfície da
+// BST: insert, remove, contains, iterador em ordem e size. A remoção marca o
+// bit baixo dos ponteiros next (do topo até o nível 0; marcar o nível 0 é o
+// ponto de linearização) e as buscas desligam fisicamente os nós marcados.
+// Quem insere e quem remove seguram uma referência cada; o último a soltar
+// varre a chave uma última vez e aposenta o nó no EpochDomain.
+
+template <typename T, typename Compare = std::less<T>>
+class ConcurrentSkipList {
+public:
+    static constexpr int kMaxLevel = 24;
+
+private:
+    struct SkipNode {
+        T key;
+        int height;
+        std::atomic<int> refs; // inseridor + removedor
+
+        SkipNode(const T& k, int h) : key(k), height(h), refs(2) {}
+
+        // Os ponteiros de cada nível ficam logo após o nó, na mesma alocação
+        std::atomic<std::uintptr_t>* next() {
+            return reinterpret_cast<std::atomic<std::uintptr_t>*>(
+                reinterpret_cast<char*>(this) + linksOffset());
+        }
+    };
+
+    static constexpr std::size_t linksOffset() {
+        return (sizeof(SkipNode) + alignof(std::atomic<std::uintptr_t>) - 1) /
+               alignof(std::atomic<std::uintptr_t>) * alignof(std::atomic<std::uintptr_t>);
+    }
+
+    alignas(64) std::atomic<std::uintptr_t> head_[kMaxLevel];
+    alignas(64) std::atomic<std::size_t> size_;
+    Compare comp_;
+
+    static bool marked(std::uintptr_t p) { return (p & 1u) != 0; }
+    static SkipNode* ptr(std::uintptr_t p) { return reinterpret_cast<SkipNode*>(p & ~std::uintptr_t(1)); }
+    static std::uintptr_t raw(SkipNode* n) { return reinterpret_cast<std::uintptr_t>(n); }
+
+    // Ponteiros do predecessor; nullptr representa a cabeça da lista
+    std::atomic<std::uintptr_t>* links(SkipNode* pred) { return pred ? pred->next() : head_; }
+    const std::atomic<std::uintptr_t>* links(SkipNode* pred) const { return pred ? pred->next() : head_; }
+
+public:
+    ConcurrentSkipList() : size_(0), comp_() {
+        for (auto& h : head_) h.store(0);
+    }
+    explicit ConcurrentSkipList(const Compare& comp) : ConcurrentSkipList() { comp_ = comp; }
+
+    // Destruição exige que nenhuma outra thread use a lista
+    ~ConcurrentSkipList() {
+        SkipNode* n = ptr(head_[0].load());
+        while (n) {
+            SkipNode* prox = ptr(n->next()[0].load());
+            destroyNode(n);
+            n = prox;
+        }
+    }
+
+    ConcurrentSkipList(const ConcurrentSkipList&) = delete;
+    ConcurrentSkipList& operator=(const ConcurrentSkipList&) = delete;
+
+    std::size_t size() const { return size_.load(); }
+    bool empty() const { return size() == 0; }
+
+    // Memória ocupada (chamar sem escritores concorrentes). Cada nó é um
+    // bloco com a chave seguida dos ponteiros de todos os seus níveis.
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m;
+        m.overheadBytes += sizeof(ConcurrentSkipList);
+        for (SkipNode* n = ptr(head_[0].load()); n; n = ptr(n->next()[0].load())) {
+            const std::size_t bytes = linksOffset() + sizeof(std::atomic<std::uintptr_t>) * n->height;
+            accountPayload(n->key, m);
+            m.overheadBytes += bytes - sizeof(T);
+            m.addBlock(bytes);
+        }
+        return m;
+    }
+
+    // Só lê: pode ser chamado por uma referência const, como em BST
+    bool contains(const T& k) const {
+        EpochGuard guard;
+        SkipNode* pred = nullptr;
+        SkipNode* curr = nullptr;
+        for (int l = kMaxLevel - 1; l >= 0; --l) {
+            curr = ptr(links(pred)[l].load());
+            while (curr) {
+                const std::uintptr_t succ = curr->next()[l].load();
+                if (marked(succ)) { curr = ptr(succ); continue; }
+                if (comp_(curr->key, k)) { pred = curr; curr = ptr(succ); }
+                else break;
+            }
+        }
+        return curr && !comp_(k, curr->key) && !marked(curr->next()[0].load());
+    }
+
+    bool insert(const T& k) {
+        EpochGuard guard;
+        SkipNode* preds[kMaxLevel];
+        SkipNode* succs[kMaxLevel];
+        SkipNode* n = nullptr;
+        while (true) {
+            if (find(k, preds, succs)) {
+                if (n) destroyNode(n);
+                return false;
+            }
+            if (!n) n = newNode(k, randomLevel());
+            for (int l = 0; l < n->height; ++l) n->next()[l].store(raw(succs[l]));
+            std::uintptr_t esperado = raw(succs[0]);
+            if (links(preds[0])[0].compare_exchange_strong(esperado, raw(n))) break;
+        }
+        size_.fetch_add(1);
+
+        // Liga os níveis superiores; desiste se o nó já estiver sendo removido
+        for (int l = 1; l < n->height; ++l) {
+            while (true) {
+                std::uintptr_t atual = n->next()[l].load();
+                if (marked(atual)) goto ligado;
+                if (ptr(atual) != succs[l] &&
+                    !n->next()[l].compare_exchange_strong(atual, raw(succs[l]))) {
+                    goto ligado;
+                }
+                std::uintptr_t esperado = raw(succs[l]);
+                if (links(preds[l])[l].compare_exchange_strong(esperado, raw(n))) break;
+                find(k, preds, succs);
+                if (succs[0] != n) goto ligado;
+            }
+        }
+    ligado:
+        release(n);
+        return true;
+    }
+
+    bool remove(const T& k) {
+        EpochGuard guard;
+        SkipNode* preds[kMaxLevel];
+        SkipNode* succs[kMaxLevel];
+        if (!find(k, preds, succs)) return false;
+        SkipNode* n = succs[0];
+
+        for (int l = n->height - 1; l >= 1; --l) {
+            std::uintptr_t succ = n->next()[l].load();
+            while (!marked(succ)) n->next()[l].compare_exchange_weak(succ, succ | 1u);
+        }
+        std::uintptr_t succ = n->next()[0].load();
+        while (true) {
+            if (marked(succ)) return false; // outra thread removeu primeiro
+            if (n->next()[0].compare_exchange_strong(succ, succ | 1u)) break;
+        }
+        size_.fetch_sub(1);
+        release(n);
+        return true;
+    }
+
+    std::vector<T> inOrder() const {
+        std::vector<T> out;
+        for (const T& k : *this) out.push_back(k);
+        return out;
+    }
+
+    // Iterador em ordem fracamente consistente: vê cada chave presente do
+    // início ao fim da iteração, e talvez as inseridas/removidas durante.
+    // Segura uma EpochGuard, portanto deve ficar na thread que o criou.
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() : n_(nullptr) {}
+        reference operator*() const { return n_->key; }
+        pointer operator->() const { return &n_->key; }
+        const_iterator& operator++() { n_ = skipMarked(ptr(n_->next()[0].load())); return *this; }
+        const_iterator operator++(int) { const_iterator c = *this; ++*this; return c; }
+        bool operator==(const const_iterator& o) const { return n_ == o.n_; }
+        bool operator!=(const const_iterator& o) const { return n_ != o.n_; }
+
+    private:
+        friend class ConcurrentSkipList;
+        // Lê o primeiro nó só depois que guard_ (membro anterior a n_) entrou
+        // na época: antes disso o nó poderia ser aposentado e liberado
+        explicit const_iterator(const std::atomic<std::uintptr_t>& primeiro)
+            : n_(skipMarked(ptr(primeiro.load()))) {}
+        static SkipNode* skipMarked(SkipNode* n) {
+            while (n && marked(n->next()[0].load())) n = ptr(n->next()[0].load());
+            return n;
+        }
+        EpochGuard guard_;
+        SkipNode* n_;
+    };
+
+    const_iterator begin() const { return const_iterator(head_[0]); }
+    const_iterator end() const { return const_iterator(); }
+
+private:
+    static std::size_t nodeBytes(int h) {
+        return linksOffset() + sizeof(std::atomic<std::uintptr_t>) * static_cast<std::size_t>(h);
+    }
+
+    static SkipNode* newNode(const T& k, int h) {
+        void* mem = countedAllocate(nodeBytes(h));
+        SkipNode* n = new (mem) SkipNode(k, h);
+        for (int l = 0; l < h; ++l) new (&n->next()[l]) std::atomic<std::uintptr_t>(0);
+        return n;
+    }
+
+    static void destroyNode(void* p) {
+        SkipNode* n = static_cast<SkipNode*>(p);
+        const std::size_t bytes = nodeBytes(n->height);
+        n->~SkipNode();
+        countedDeallocate(p, bytes);
+    }
+
+    // Altura geométrica (p = 1/2) com um xorshift por thread
+    static int randomLevel() {
+        thread_local std::uint64_t x = 0x9E3779B97F4A7C15ull ^ reinterpret_cast<std::uintptr_t>(&x);
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        int h = 1;
+        while (h < kMaxLevel && (x & (std::uint64_t(1) << h))) ++h;
+        return h;
+    }
+
+    // Localiza preds/succs de k em todos os níveis, desligando os nós
+    // marcados encontrados no caminho. Retorna true se k está presente.
+    bool find(const T& k, SkipNode** preds, SkipNode** succs) {
+    recomeca:
+        SkipNode* pred = nullptr;
+        for (int l = kMaxLevel - 1; l >= 0; --l) {
+            SkipNode* curr = ptr(links(pred)[l].load());
+            while (curr) {
+                std::uintptr_t succ = curr->next()[l].load();
+                while (marked(succ)) {
+                    std::uintptr_t esperado = raw(curr);
+                    if (!links(pred)[l].compare_exchange_strong(esperado, succ & ~std::uintptr_t(1))) {
+                        goto recomeca;
+                    }
+                    curr = ptr(succ);
+                    if (!curr) break;
+                    succ = curr->next()[l].load();
+                }
+                if (!curr) break;
+                if (comp_(curr->key, k)) { pred = curr; curr = ptr(succ); }
+                else break;
+            }
+            preds[l] = pred;
+            succs[l] = curr;
+        }
+        return succs[0] && !comp_(k, succs[0]->key);
+    }
+
+    // Solta uma referência; o último dono garante o desligamento e aposenta
+    void release(SkipNode* n) {
+        if (n->refs.fetch_sub(1) != 1) return;
+        SkipNode* preds[kMaxLevel];
+        SkipNode* succs[kMaxLevel];
+        find(n->key, preds, succs);
+        EpochDomain::instance().retire(n, &destroyNode);
+    }
+};
+
+// ==================================================
+// Classe SPSCRing (fila circular produtor/consumidor único)
+// ==================================================
+// Um produtor e um consumidor, sem locks e sem espera: cada lado só escreve
+// o próprio índice (tail para o produtor, head para o consumidor) e lê o do
+// outro com acquire. Os índices crescem sem voltar ao zero e a posição é
+// índice & mascara. Cada lado guarda uma cópia do índice do outro e só
+// relê o atômico quando a cópia diz que o anel está cheio/vazio, o que
+// evita puxar a linha de cache alheia a cada operação. head e tail ficam
+// em linhas de cache separadas para não haver falso compartilhamento.
+
+template <typename T>
+class SPSCRing {
+public:
+    // A capacidade é arredondada para a próxima potência de 2
+    explicit SPSCRing(std::size_t capacity = 1024) {
+        std::size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        mascara_ = cap - 1;
+        buf_ = CountingAllocator<T>().allocate(cap);
+    }
+
+    SPSCRing(const SPSCRing&) = delete;
+    SPSCRing& operator=(const SPSCRing&) = delete;
+
+    ~SPSCRing() {
+        const std::size_t t = prod_.tail.load(std::memory_order_relaxed);
+        for (std::size_t h = cons_.head.load(std::memory_order_relaxed); h != t; ++h) {
+            buf_[h & mascara_].~T();
+        }
+        CountingAllocator<T>().deallocate(buf_, mascara_ + 1);
+    }
+
+    std::size_t capacity() const { return mascara_ + 1; }
+
+    // Tamanho aproximado (exato só com os dois lados parados)
+    std::size_t sizeApprox() const {
+        const std::size_t h = cons_.head.load(std::memory_order_acquire);
+        const std::size_t t = prod_.tail.load(std::memory_order_acquire);
+        return t - h;
+    }
+
+    bool emptyApprox() const { return sizeApprox() == 0; }
+
+    // --- Lado do produtor ---
+
+    template <typename... Args>
+    bool tryEmplace(Args&&... args) {
+        const std::size_t t = prod_.tail.load(std::memory_order_relaxed);
+        if (t - prod_.headCache == capacity()) {
+            prod_.headCache = cons_.head.load(std::memory_order_acquire);
+            if (t - prod_.headCache == capacity()) return false;
+        }
+        ::new (static_cast<void*>(buf_ + (t & mascara_))) T(std::forward<Args>(args)...);
+        prod_.tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPush(const T& v) { return tryEmplace(v); }
+    bool tryPush(T&& v) { return tryEmplace(std::move(v)); }
+
+    // Constrói até n elementos a partir de `dados` com uma única publicação
+    // do tail e devolve quantos couberam. Com um ponteiro os elementos são
+    // copiados; com std::make_move_iterator(p), movidos.
+    template <typename It>
+    std::size_t pushBatch(It dados, std::size_t n) {
+        const std::size_t t = prod_.tail.load(std::memory_order_relaxed);
+        std::size_t livre = capacity() - (t - prod_.headCache);
+        if (livre < n) {
+            prod_.headCache = cons_.head.load(std::memory_order_acquire);
+            livre = capacity() - (t - prod_.headCache);
+        }
+        n = std::min(n, livre);
+        for (std::size_t i = 0; i < n; ++i, ++dados) {
+            ::new (static_cast<void*>(buf_ + ((t + i) & mascara_))) T(*dados);
+        }
+        if (n > 0) prod_.tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+    // --- Lado do consumidor ---
+
+    bool tryPop(T& out) {
+        const std::size_t h = cons_.head.load(std::memory_order_relaxed);
+        if (h == cons_.tailCache) {
+            cons_.tailCache = prod_.tail.load(std::memory_order_acquire);
+            if (h == cons_.tailCache) return false;
+        }
+        T* p = buf_ + (h & mascara_);
+        out = std::move(*p);
+        p->~T();
+        cons_.head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Move até `max` elementos para `out` com uma única publicação do head
+    // e devolve quantos saíram
+    std::size_t popBatch(T* out, std::size_t max) {
+        const std::size_t h = cons_.head.load(std::memory_order_relaxed);
+        std::size_t disp = cons_.tailCache - h;
+        if (disp < max) {
+            cons_.tailCache = prod_.tail.load(std::memory_order_acquire);
+            disp = cons_.tailCache - h;
+        }
+        const std::size_t n = std::min(max, disp);
+        for (std::size_t i = 0; i < n; ++i) {
+            T* p = buf_ + ((h + i) & mascara_);
+            out[i] = std::move(*p);
+            p->~T();
+        }
+        if (n > 0) cons_.head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    // Só faz sentido com produtor e consumidor parados
+    MemoryUsage memoryUsage() const {
+        MemoryUsage m;
+        const std::size_t h = cons_.head.load(std::memory_order_relaxed);
+        const std::size_t t = prod_.tail.load(std::memory_order_relaxed);
+        accountElements<T>(t - h, m, [&] {
+            for (std::size_t i = h; i != t; ++i) accountPayload(buf_[i & mascara_], m);
+        });
+        m.overheadBytes += sizeof(SPSCRing) + (capacity() - (t - h)) * sizeof(T);
+        m.addBlock(capacity() * sizeof(T));
+        return m;
+    }
+
+private:
+    struct alignas(64) Produtor {
+        std::atomic<std::size_t> tail{ 0 };
+        std::size_t headCache = 0; // última leitura de cons_.head
+    };
+    struct alignas(64) Consumidor {
+        std::atomic<std::size_t> head{ 0 };
+        std::size_t tailCache = 0; // última leitura de prod_.tail
+    };
+
+    alignas(64) T* buf_;
+    std::size_t mascara_;
+    Produtor prod_;
+    Consumidor cons_;
+};
+
+// ==================================================
+// Classe Pipeline (estágios encadeados por SPSCRing)
+// ==================================================
+// Cada estágio roda na própria thread, lê do anel anterior e escreve no
+// seguinte, então todo anel tem exatamente um produtor e um consumidor:
+//
+//     auto p = makePipeline<int>(1024)
+//                  .then([](int x) { return x * 2; })
+//                  .then([](int x) { return std::to_string(x); });
+//     p.push(1); ...; p.close();
+//     std::string s;
+//     while (p.pop(s)) { ... }
+//
+// push/close são chamados por uma única thread e pop por uma única thread
+// (podem ser a mesma). Esperas giram cedendo a CPU com yield. Destruir a
+// pipeline fecha a entrada, cancela os estágios e espera as threads.
+// Uma exceção num estágio cancela a pipeline: push passa a descartar e
+// pop, depois de entregar o que já estava pronto, relança a exceção.
+
+// Elo entre dois estágios: o anel e o aviso de que o produtor terminou
+template <typename T>
+struct PipelineLink {
+    explicit PipelineLink(std::size_t cap) : ring(cap) {}
+    SPSCRing<T> ring;
+    std::atomic<bool> fechado{ false };
+};
+
+// Compartilhado por todos os estágios de uma pipeline com entrada In
+template <typename In>
+struct PipelineState {
+    std::size_t capacidade = 0;
+    std::shared_ptr<PipelineLink<In>> entrada;
+    std::vector<std::thread> threads;
+    std::atomic<bool> cancelado{ false };
+    std::atomic<bool> falhou{ false };
+    std::exception_ptr erro;  // escrito só por quem marcou `falhou`
+
+    ~PipelineState() {
+        entrada->fechado.store(true, std::memory_order_release);
+        cancelado.store(true, std::memory_order_release);
+        for (auto& t : threads) t.join();
+    }
+};
+
+template <typename In, typename Out = In>
+class Pipeline {
+    template <typename A, typename B> friend class Pipeline;
+    template <typename T> friend Pipeline<T> makePipeline(std::size_t);
+
+    // Elementos processados por um estágio de uma vez
+    static constexpr std::size_t kLote = 64;
+
+    std::shared_ptr<PipelineState<In>> st_;
+    std::shared_ptr<PipelineLink<Out>> saida_;
+
+    Pipeline(std::shared_ptr<PipelineState<In>> st, std::shared_ptr<PipelineLink<Out>> saida)
+        : st_(std::move(st)), saida_(std::move(saida)) {}
+
+public:
+    Pipeline(Pipeline&&) = default;
+    Pipeline& operator=(Pipeline&&) = default;
+
+    // Acrescenta um estágio f: Out -> R numa nova thread. A pipeline atual
+    // é consumida (use o objeto devolvido). Out e R precisam ter construtor
+    // padrão: o estágio trabalha sobre lotes em arrays locais.
+    template <typename F>
+    auto then(F f) && -> Pipeline<In, std::decay_t<decltype(f(std::declval<Out&&>()))>> {
+        using R = std::decay_t<decltype(f(std::declval<Out&&>()))>;
+        auto prox = std::make_shared<PipelineLink<R>>(st_->capacidade);
+        PipelineState<In>* st = st_.get();
+        st_->threads.emplace_back([st, ant = saida_, prox, f]() mutable {
+            try {
+                std::unique_ptr<Out[]> entrada(new Out[kLote]);
+                std::unique_ptr<R[]> saida(new R[kLote]);
+                while (true) {
+                    // Lê `fechado` antes de tentar: se já estava fechado e o
+                    // anel está vazio, não virá mais nada
+                    const bool fim = ant->fechado.load(std::memory_order_acquire);
+                    const std::size_t n = ant->ring.popBatch(entrada.get(), kLote);
+                    if (n == 0) {
+                        if (fim || st->cancelado.load(std::memory_order_acquire)) break;
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    for (std::size_t i = 0; i < n; ++i) saida[i] = f(std::move(entrada[i]));
+                    for (std::size_t feito = 0; feito < n;) {
+                        feito += prox->ring.pushBatch(std::make_move_iterator(saida.get() + feito), n - feito);
+                        if (feito == n) break;
+                        if (st->cancelado.load(std::memory_order_acquire)) break;
+                        std::this_thread::yield();
+                    }
+                }
+            } catch (...) {
+                // Fica só a primeira falha; o fechamento abaixo a publica
+                if (!st->falhou.exchange(true, std::memory_order_acq_rel)) st->erro = std::current_exception();
+                st->cancelado.store(true, std::memory_order_release);
+            }
+            prox->fechado.store(true, std::memory_order_release);
+        });
+        return Pipeline<In, R>(std::move(st_), std::move(prox));
+    }
+
+    // Entrada (thread produtora)
+    bool tryPush(const In& v) { return st_->entrada->ring.tryPush(v); }
+
+    void push(const In& v) {
+        while (!st_->entrada->ring.tryPush(v)) {
+            if (st_->cancelado.load(std::memory_order_acquire)) return;
+            std::this_thread::yield();
+        }
+    }
+
+    // Avisa que não haverá mais entradas; os estágios esvaziam e terminam
+    void close() { st_->entrada->fechado.store(true, std::memory_order_release); }
+
+    // Saída (thread consumidora)
+    bool tryPop(Out& out) { return saida_->ring.tryPop(out); }
+
+    // Espera o próximo resultado; false quando a pipeline terminou
+    bool pop(Out& out) {
+        while (true) {
+            const bool fim = saida_->fechado.load(std::memory_order_acquire);
+            if (saida_->ring.tryPop(out)) return true;
+            if (fim) {
+                if (st_->falhou.load(std::memory_order_acquire)) std::rethrow_exception(st_->erro);
+                return false;
+            }
+            std::this_thread::yield();
+        }
+    }
+};
+
+template <typename T>
+Pipeline<T> makePipeline(std::size_t capacidade = 1024) {
+    auto st = std::make_shared<PipelineState<T>>();
+    st->capacidade = capacidade;
+    st->entrada = std::make_shared<PipelineLink<T>>(capacidade);
+    auto entrada = st->entrada;
+    return Pipeline<T>(std::move(st), std::move(entrada));
+}
+
+// ====================================================
+// Traços de operações (gravação e reprodução)
+// ====================================================
+// Para reproduzir uma lentidão vista em produção, os wrappers Recording*
+// anotam cada operação de um contêiner num arquivo binário compacto, e
+// replayTrace() roda o mesmo traço contra qualquer backend, medindo a
+// latência de cada operação.
+//
+// Formato: "DSLT" + 1 byte de versão, depois um registro por operação:
+// 1 byte com o código; se a operação leva chave, a diferença para a chave
+// anterior do traço em zigzag + varint (chaves próximas gastam 1 ou 2
+// bytes); enqueue leva ainda a prioridade em varint. As chaves são
+// inteiras de até 64 bits.
+
+enum class TraceOp : std::uint8_t { Insert, Remove, Contains, Enqueue, Dequeue, Push, Pop };
+constexpr std::size_t kTraceOps = 7;
+
+inline const char* traceOpName(TraceOp op) {
+    static const char* const nomes[kTraceOps] = { "insert", "remove", "contains", "enqueue",
+                                                  "dequeue", "push", "pop" };
+    return nomes[static_cast<std::size_t>(op)];
+}
+
+inline bool traceOpHasKey(TraceOp op) { return op != TraceOp::Dequeue && op != TraceOp::Pop; }
+
+struct TraceRecord {
+    TraceOp op = TraceOp::Insert;
+    std::int64_t key = 0;
+    std::uint64_t priority = 0;  // só em Enqueue
+};
+
+inline std::uint64_t zigzagEncode(std::int64_t v) {
+    return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+}
+inline std::int64_t zigzagDecode(std::uint64_t u) {
+    return static_cast<std::int64_t>(u >> 1) ^ -static_cast<std::int64_t>(u & 1);
+}
+
+// Grava v em p (7 bits por byte, bit alto = continua); retorna os bytes usados
+inline std::size_t putVarint(std::uint8_t* p, std::uint64_t v) {
+    std::size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = static_cast<std::uint8_t>(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = static_cast<std::uint8_t>(v);
+    return n;
+}
+
+// Escreve o traço num arquivo. record() só codifica no buffer da frente;
+// cheio, ele troca de lugar com o de trás, que uma thread de fundo grava
+// no disco. Se a thread ainda estiver gravando o anterior, record() espera
+// (dois buffers bastam: o disco só atrasa quem grava mais rápido do que ele).
+// Uma instância deve ser usada por uma thread de cada vez.
+class TraceWriter {
+    static constexpr std::size_t kMaxRecord = 1 + 10 + 10;  // código + 2 varints
+
+    std::FILE* f_;
+    std::vector<std::uint8_t> frente_;
+    std::vector<std::uint8_t> tras_;
+    std::size_t usado_ = 0;      // bytes ocupados em frente_
+    std::size_t trasUsado_ = 0;  // bytes de tras_ a gravar
+    bool trasPronto_ = false;
+    bool parar_ = false;
+    bool erro_ = false;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::thread escritor_;
+    std::int64_t ultimaChave_ = 0;
+    std::uint64_t ops_ = 0;
+    std::uint64_t bytes_ = 0;
+
+    void handOff() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cv_.wait(lock, [this] { return !trasPronto_; });
+        frente_.swap(tras_);
+        trasUsado_ = usado_;
+        trasPronto_ = true;
+        usado_ = 0;
+        cv_.notify_all();
+    }
+
+    void writerLoop() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (true) {
+            cv_.wait(lock, [this] { return trasPronto_ || parar_; });
+            if (!trasPronto_) return;
+            const std::size_t n = trasUsado_;
+            lock.unlock();
+            const bool ok = std::fwrite(tras_.data(), 1, n, f_) == n;
+            lock.lock();
+            if (!ok) erro_ = true;
+            bytes_ += n;
+            trasPronto_ = false;
+            cv_.notify_all();
+        }
+    }
+
+public:
+    explicit TraceWriter(const std::string& path, std::size_t bufferBytes = std::size_t(1) << 16)
+        : f_(std::fopen(path.c_str(), "wb")),
+          frente_(std::max(bufferBytes, 4 * kMaxRecord)),
+          tras_(frente_.size()) {
+        if (!f_) throw std::runtime_error("Não foi possível abrir o traço: " + path);
+        const std::uint8_t cabecalho[5] = { 'D', 'S', 'L', 'T', 1 };
+        std::copy(cabecalho, cabecalho + 5, frente_.data());
+        usado_ = 5;
+        escritor_ = std::thread(&TraceWriter::writerLoop, this);
+    }
+
+    ~TraceWriter() {
+        flush();
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            parar_ = true;
+        }
+        cv_.notify_all();
+        escritor_.join();
+        std::fclose(f_);
+    }
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    void record(TraceOp op, std::int64_t key = 0, std::uint64_t priority = 0) {
+        if (usado_ + kMaxRecord > frente_.size()) handOff();
+        std::uint8_t* p = frente_.data() + usado_;
+        *p++ = static_cast<std::uint8_t>(op);
+        if (traceOpHasKey(op)) {
+            // Diferença em aritmética sem sinal: dá a volta sem estouro
+            const auto delta = static_cast<std::int64_t>(static_cast<std::uint64_t>(key) -
+                                                         static_cast<std::uint64_t>(ultimaChave_));
+            p += putVarint(p, zigzagEncode(delta));
+            ultimaChave_ = key;
+        }
+        if (op == TraceOp::Enqueue) p += putVarint(p, priority);
+        usado_ = static_cast<std::size_t>(p - frente_.data());
+        ++ops_;
+    }
+
+    // Entrega o que estiver no buffer e espera chegar ao arquivo
+    void flush() {
+        if (usado_ > 0) handOff();
+        std::unique_lock<std::mutex> lock(mtx_);
+        cv_.wait(lock, [this] { return !trasPronto_; });
+        if (std::fflush(f_) != 0) erro_ = true;
+    }
+
+    std::uint64_t opsRecorded() const { return ops_; }
+
+    // Bytes já gravados no arquivo (sem contar o buffer atual)
+    std::uint64_t bytesWritten() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return bytes_;
+    }
+
+    // false se alguma escrita falhou (disco cheio, por exemplo)
+    bool ok() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return !erro_;
+    }
+};
+
+// Lê um traço inteiro para a memória e o decodifica registro a registro
+class TraceReader {
+    std::vector<std::uint8_t> dados_;
+    std::size_t pos_ = 5;
+    std::int64_t ultimaChave_ = 0;
+
+    std::uint64_t getVarint() {
+        std::uint64_t v = 0;
+        for (unsigned desloc = 0; desloc < 64; desloc += 7) {
+            if (pos_ >= dados_.size()) throw std::runtime_error("Traço truncado");
+            const std::uint8_t b = dados_[pos_++];
+            v |= static_cast<std::uint64_t>(b & 0x7F) << desloc;
+            if (!(b & 0x80)) return v;
+        }
+        throw std::runtime_error("Traço corrompido");
+    }
+
+public:
+    explicit TraceReader(const std::string& path) {
+        std::FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) throw std::runtime_error("Não foi possível abrir o traço: " + path);
+        std::uint8_t buf[1 << 16];
+        std::size_t n;
+        while ((n = std::fread(buf, 1, sizeof buf, f)) > 0) dados_.insert(dados_.end(), buf, buf + n);
+        std::fclose(f);
+        const std::uint8_t esperado[5] = { 'D', 'S', 'L', 'T', 1 };
+        if (dados_.size() < 5 || !std::equal(esperado, esperado + 5, dados_.begin()))
+            throw std::runtime_error("Arquivo não é um traço DSLT v1: " + path);
+    }
+
+    // Próximo registro; false no fim do traço
+    bool next(TraceRecord& r) {
+        if (pos_ >= dados_.size()) return false;
+        const std::uint8_t op = dados_[pos_++];
+        if (op >= kTraceOps) throw std::runtime_error("Traço corrompido");
+        r.op = static_cast<TraceOp>(op);
+        r.key = 0;
+        r.priority = 0;
+        if (traceOpHasKey(r.op)) {
+            r.key = static_cast<std::int64_t>(static_cast<std::uint64_t>(ultimaChave_) +
+                                              static_cast<std::uint64_t>(zigzagDecode(getVarint())));
+            ultimaChave_ = r.key;
+        }
+        if (r.op == TraceOp::Enqueue) r.priority = getVarint();
+        return true;
+    }
+
+    std::vector<TraceRecord> readAll() {
+        std::vector<TraceRecord> out;
+        TraceRecord r;
+        while (next(r)) out.push_back(r);
+        return out;
+    }
+
+    std::size_t fileBytes() const { return dados_.size(); }
+};
+
+// ---- Wrappers de gravação ----
+// Guardam referências para o contêiner e para o TraceWriter: gravar é
+// opcional e não muda o tipo do contêiner usado no resto do código. Cada
+// operação é anotada depois de concluída (um dequeue que lança por fila
+// vazia não entra no traço). Chaves precisam ser inteiras.
+
+template <typename T, typename Compare = std::less<T>>
+class RecordingBST {
+    static_assert(std::is_integral<T>::value, "traços guardam chaves inteiras");
+    BST<T, Compare>& t_;
+    TraceWriter& w_;
+
+public:
+    RecordingBST(BST<T, Compare>& t, TraceWriter& w) : t_(t), w_(w) {}
+
+    void insert(const T& k) {
+        t_.insert(k);
+        w_.record(TraceOp::Insert, static_cast<std::int64_t>(k));
+    }
+    bool remove(const T& k) {
+        const bool r = t_.remove(k);
+        w_.record(TraceOp::Remove, static_cast<std::int64_t>(k));
+        return r;
+    }
+    bool contains(const T& k) const {
+        const bool r = t_.contains(k);
+        w_.record(TraceOp::Contains, static_cast<std::int64_t>(k));
+        return r;
+    }
+
+    std::size_t size() const { return t_.size(); }
+    BST<T, Compare>& get() { return t_; }
+};
+
+template <typename T>
+class RecordingPriorityQueue {
+    static_assert(std::is_integral<T>::value, "traços guardam chaves inteiras");
+    PriorityQueue<T>& q_;
+    TraceWriter& w_;
+
+public:
+    using Handle = typename PriorityQueue<T>::Handle;
+
+    RecordingPriorityQueue(PriorityQueue<T>& q, TraceWriter& w) : q_(q), w_(w) {}
+
+    Handle enqueue(T value, unsigned int priority) {
+        const auto k = static_cast<std::int64_t>(value);
+        Handle h = q_.enqueue(std::move(value), priority);
+        w_.record(TraceOp::Enqueue, k, priority);
+        return h;
+    }
+    T dequeue() {
+        T v = q_.dequeue();
+        w_.record(TraceOp::Dequeue);
+        return v;
+    }
+
+    bool isEmpty() const { return q_.isEmpty(); }
+    PriorityQueue<T>& get() { return q_; }
+};
+
+template <typename T, typename List = LinkedList<T>>
+class RecordingQueue {
+    static_assert(std::is_integral<T>::value, "traços guardam chaves inteiras");
+    Queue<T, List>& q_;
+    TraceWriter& w_;
+
+public:
+    RecordingQueue(Queue<T, List>& q, TraceWriter& w) : q_(q), w_(w) {}
+
+    void enqueue(T x) {
+        const auto k = static_cast<std::int64_t>(x);
+        q_.enqueue(std::move(x));
+        w_.record(TraceOp::Enqueue, k);
+    }
+    T dequeue() {
+        T v = q_.dequeue();
+        w_.record(TraceOp::Dequeue);
+        return v;
+    }
+
+    bool isEmpty() const { return q_.isEmpty(); }
+    Queue<T, List>& get() { return q_; }
+};
+
+template <typename T, typename List = LinkedList<T>>
+class RecordingStack {
+    static_assert(std::is_integral<T>::value, "traços guardam chaves inteiras");
+    Stack<T, List>& s_;
+    TraceWriter& w_;
+
+public:
+    RecordingStack(Stack<T, List>& s, TraceWriter& w) : s_(s), w_(w) {}
+
+    void push(T x) {
+        const auto k = static_cast<std::int64_t>(x);
+        s_.push(std::move(x));
+        w_.record(TraceOp::Push, k);
+    }
+    T pop() {
+        T v = s_.pop();
+        w_.record(TraceOp::Pop);
+        return v;
+    }
+
+    bool isEmpty() const { return s_.isEmpty(); }
+    Stack<T, List>& get() { return s_; }
+};
+
+// ---- Reprodução ----
+
+// Histograma de latências em faixas de potência de 2 (faixa b cobre
+// [2^b, 2^(b+1)) ns; a faixa 0 também recebe 0 ns)
+struct LatencyHistogram {
+    std::array<std::uint64_t, 64> buckets{};
+    std::uint64_t count = 0;
+    std::uint64_t totalNs = 0;
+    std::uint64_t maxNs = 0;
+
+    void add(std::uint64_t ns) {
+        ++buckets[faixa(ns)];
+        ++count;
+        totalNs += ns;
+        if (ns > maxNs) maxNs = ns;
+    }
+
+    double meanNs() const { return count ? static_cast<double>(totalNs) / static_cast<double>(count) : 0.0; }
+
+    // Limite superior da faixa em que cai o quantil q (0..1)
+    std::uint64_t percentileNs(double q) const {
+        if (count == 0) return 0;
+        const double alvo = q * static_cast<double>(count);
+        std::uint64_t acumulado = 0;
+        for (std::size_t b = 0; b < buckets.size(); ++b) {
+            acumulado += buckets[b];
+            if (static_cast<double>(acumulado) >= alvo) return std::min(maxNs, (std::uint64_t(2) << b) - 1);
+        }
+        return maxNs;
+    }
+
+    // Índice do bit mais alto de ns (0 para ns = 0)
+    static std::size_t faixa(std::uint64_t ns) {
+        if (ns == 0) return 0;
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<std::size_t>(63 - __builtin_clzll(ns));
+#else
+        std::size_t b = 0;
+        while (ns >>= 1) ++b;
+        return b;
+#endif
+    }
+};
+
+struct TraceReplayReport {
+    std::array<LatencyHistogram, kTraceOps> perOp{};
+    std::uint64_t ops = 0;
+    std::uint64_t totalNs = 0;
+    // Soma dos resultados (contains = 0/1, valores de dequeue/pop): dois
+    // backends que reproduzem o mesmo traço corretamente dão o mesmo valor
+    std::uint64_t checksum = 0;
+
+    const LatencyHistogram& of(TraceOp op) const { return perOp[static_cast<std::size_t>(op)]; }
+};
+
+// Aplica um registro a um backend e devolve o resultado para o checksum.
+// A versão genérica atende conjuntos com insert/remove/contains (BST,
+// BTree, ConcurrentSkipList...); filas, pilhas e a fila de prioridade têm
+// sobrecargas próprias. Outros backends basta sobrecarregar esta função.
+template <typename Set>
+std::uint64_t applyTraceRecord(Set& s, const TraceRecord& r) {
+    using K = typename std::decay<decltype(*s.begin())>::type;
+    switch (r.op) {
+    case TraceOp::Insert: s.insert(static_cast<K>(r.key)); return 0;
+    case TraceOp::Remove: return s.remove(static_cast<K>(r.key));
+    case TraceOp::Contains: return s.contains(static_cast<K>(r.key));
+    default: throw std::invalid_argument(std::string("Backend não suporta ") + traceOpName(r.op));
+    }
+}
+
+template <typename T, typename List>
+std::uint64_t applyTraceRecord(Queue<T, List>& q, const TraceRecord& r) {
+    switch (r.op) {
+    case TraceOp::Enqueue: q.enqueue(static_cast<T>(r.key)); return 0;
+    case TraceOp::Dequeue: return static_cast<std::uint64_t>(q.dequeue());
+    default: throw std::invalid_argument(std::string("Backend não suporta ") + traceOpName(r.op));
+    }
+}
+
+template <typename T, typename List>
+std::uint64_t applyTraceRecord(Stack<T, List>& s, const TraceRecord& r) {
+    switch (r.op) {
+    case TraceOp::Push: s.push(static_cast<T>(r.key)); return 0;
+    case TraceOp::Pop: return static_cast<std::uint64_t>(s.pop());
+    default: throw std::invalid_argument(std::string("Backend não suporta ") + traceOpName(r.op));
+    }
+}
+
+template <typename T>
+std::uint64_t applyTraceRecord(PriorityQueue<T>& q, const TraceRecord& r) {
+    switch (r.op) {
+    case TraceOp::Enqueue: q.enqueue(static_cast<T>(r.key), static_cast<unsigned int>(r.priority)); return 0;
+    case TraceOp::Dequeue: return static_cast<std::uint64_t>(q.dequeue());
+    default: throw std::invalid_argument(std::string("Backend não suporta ") + traceOpName(r.op));
+    }
+}
+
+// Roda o traço (já decodificado, para a leitura não entrar na medida)
+// contra o backend, com uma leitura de steady_clock por operação. O custo
+// de ler o relógio e anotar a amostra (dezenas de ns) entra em todas por igual.
+template <typename Backend>
+TraceReplayReport replayTrace(const std::vector<TraceRecord>& trace, Backend& backend) {
+    using Relogio = std::chrono::steady_clock;
+    TraceReplayReport rep;
+    const auto inicio = Relogio::now();
+    auto antes = inicio;
+    for (const TraceRecord& r : trace) {
+        rep.checksum += applyTraceRecord(backend, r);
+        const auto depois = Relogio::now();
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(depois - antes).count();
+        rep.perOp[static_cast<std::size_t>(r.op)].add(static_cast<std::uint64_t>(ns));
+        antes = depois;
+    }
+    rep.ops = trace.size();
+    rep.totalNs = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(antes - inicio).count());
+    return rep;
+}
@@ -1,28 +1,282 @@
 #include <SFML/Graphics.hpp>
 #include <unordered_map>
 #include <string>
-#include <sstream>
+#include <charconv>
+#include <fstream>
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
 #include "include/DataStructLib.hpp"
 
 enum class Traversal { Pre, In, Post };
-enum class Mode { View, Insert, Delete };
+enum class Mode { View, Insert, Delete, Bulk };
 
-static std::string joinInts(const std::vector<int>& v) {
-    std::ostringstream oss;
-    for (std::size_t i = 0; i < v.size(); ++i) {
-        if (i) oss << ' ';
-        oss << v[i];
-    }
-    return oss.str();
+// Formatação de inteiros sem iostream (std::to_chars não aloca nem usa locale)
+static inline void appendInt(std::string& out, int v) {
+    char buf[16];
+    const auto r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, r.ptr);
 }
 
 static inline sf::String U8(const std::string& s) {
     return sf::String::fromUtf8(s.begin(), s.end());
 }
 
+// =====================================================
+// Thread de mutação/layout
+// =====================================================
+// A árvore pertence à thread de trabalho: a thread de desenho só envia
+// comandos (fila protegida por mutex) e lê o último LayoutSnapshot
+// publicado. São dois buffers: o publicado, que a renderização está usando,
+// e o reserva, onde o próximo layout é montado aproveitando a memória.
+
+struct Command {
+    enum class Type { Insert, Delete, RandomBulk, FileBulk, SetTraversal };
+    Type type = Type::Insert;
+    int value = 0;          // chave (Insert/Delete) ou quantidade (RandomBulk)
+    std::string path;       // arquivo (FileBulk)
+    Traversal trav = Traversal::Pre;
+};
+
+// Nó pronto para desenhar: sem ponteiros para a árvore viva
+struct DrawNode {
+    int key;
+    float x, y;         // posição normalizada 0..1
+    int left, right;    // índices em LayoutSnapshot::nodes (-1 se ausente/oculto)
+};
+
+struct LayoutSnapshot {
+    std::vector<DrawNode> nodes;
+    std::string traversalText;          // percurso escolhido, já formatado
+    std::vector<std::size_t> valueStart; // início de cada valor em traversalText
+    std::size_t totalNodes = 0;
+    bool truncated = false;     // níveis profundos omitidos do desenho
+    unsigned long version = 0;
+};
+
+class TreeWorker {
+public:
+    // Acima disso só os níveis de cima são desenhados
+    static constexpr std::size_t kMaxDrawNodes = 2047;
+    // Inserções em lote são aplicadas em pedaços deste tamanho
+    static constexpr std::size_t kBulkChunk = 20000;
+    // Lotes (aleatórios ou de arquivo) maiores que isso são cortados
+    static constexpr int kBulkMax = 2000000;
+
+    TreeWorker()
+        : front_(std::make_shared<LayoutSnapshot>()),
+          spare_(std::make_shared<LayoutSnapshot>()) {
+        tree_.insert_Node(50);
+        rebuildSnapshot();
+        th_ = std::thread([this] { run(); });
+    }
+
+    ~TreeWorker() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        th_.join();
+    }
+
+    void post(Command c) {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            fila_.enqueue(std::move(c));
+        }
+        cv_.notify_one();
+    }
+
+    std::shared_ptr<const LayoutSnapshot> snapshot() const {
+        std::lock_guard<std::mutex> lock(snapMtx_);
+        return front_;
+    }
+
+    // Progresso do lote em andamento (total == 0 quando não há lote)
+    std::size_t bulkDone() const { return bulkDone_.load(); }
+    std::size_t bulkTotal() const { return bulkTotal_.load(); }
+
+    // Mensagem do último comando que falhou (vazia se nenhum falhou)
+    std::string lastError() const {
+        std::lock_guard<std::mutex> lock(snapMtx_);
+        return erro_;
+    }
+
+private:
+    BST<int> tree_;
+    Traversal trav_ = Traversal::Pre;
+    unsigned long version_ = 0;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    Queue<Command, UnrolledLinkedList<Command>> fila_;
+    bool stop_ = false;
+
+    mutable std::mutex snapMtx_;
+    std::shared_ptr<LayoutSnapshot> front_;
+    std::shared_ptr<LayoutSnapshot> spare_;
+    std::string erro_;
+
+    std::atomic<std::size_t> bulkDone_{ 0 };
+    std::atomic<std::size_t> bulkTotal_{ 0 };
+
+    std::thread th_;
+
+    void run() {
+        while (true) {
+            Command c;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_.wait(lock, [this] { return stop_ || !fila_.isEmpty(); });
+                if (stop_) return;
+                c = fila_.dequeue();
+            }
+            // Um comando que falha (ex.: sem memória para o lote) não pode
+            // derrubar o processo: a árvore fica com o que já entrou
+            try {
+                apply(c);
+            } catch (const std::exception& e) {
+                bulkTotal_ = 0;
+                {
+                    std::lock_guard<std::mutex> lock(snapMtx_);
+                    erro_ = e.what();
+                }
+                try { rebuildSnapshot(); } catch (const std::exception&) {}
+            }
+        }
+    }
+
+    void apply(const Command& c) {
+        switch (c.type) {
+            case Command::Type::Insert:
+                tree_.insert_Node(c.value);
+                break;
+            case Command::Type::Delete:
+                tree_.delete_Node(c.value);
+                break;
+            case Command::Type::SetTraversal:
+                trav_ = c.trav;
+                break;
+            case Command::Type::RandomBulk: {
+                const int n = std::clamp(c.value, 0, kBulkMax);
+                std::mt19937 gen(std::random_device{}());
+                std::uniform_int_distribution<long long> dist(-10LL * n, 10LL * n);
+                std::vector<int> chaves(static_cast<std::size_t>(n));
+                for (auto& k : chaves) k = static_cast<int>(dist(gen));
+                bulkInsert(chaves);
+                break;
+            }
+            case Command::Type::FileBulk: {
+                std::ifstream in(c.path);
+                std::vector<int> chaves;
+                int k;
+                while (chaves.size() < static_cast<std::size_t>(kBulkMax) && in >> k) chaves.push_back(k);
+                bulkInsert(chaves);
+                break;
+            }
+        }
+        rebuildSnapshot();
+    }
+
+    // Insere em pedaços, publicando layouts intermediários (no máximo a
+    // cada ~100 ms) para que a tela acompanhe o crescimento da árvore
+    void bulkInsert(const std::vector<int>& chaves) {
+        // Arquivos ordenados viram listas encadeadas numa BST comum, e os
+        // percursos recursivos estourariam a pilha: lotes ligam o bode expiatório
+        if (tree_.balancePolicy() == BalancePolicy::None) tree_.setBalancePolicy(BalancePolicy::Scapegoat);
+        bulkDone_ = 0;
+        bulkTotal_ = chaves.size();
+        auto ultimo = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < chaves.size(); i += kBulkChunk) {
+            const std::size_t fim = std::min(chaves.size(), i + kBulkChunk);
+            for (std::size_t j = i; j < fim; ++j) tree_.insert_Node(chaves[j]);
+            bulkDone_ = fim;
+            const auto agora = std::chrono::steady_clock::now();
+            if (agora - ultimo > std::chrono::milliseconds(100)) {
+                rebuildSnapshot();
+                ultimo = agora;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                if (stop_) break;
+            }
+        }
+        bulkTotal_ = 0;
+    }
+
+    // Monta o próximo layout no buffer reserva e troca com o publicado
+    void rebuildSnapshot() {
+        {
+            // Se a renderização ainda segura o buffer reserva, aloca outro
+            std::lock_guard<std::mutex> lock(snapMtx_);
+            if (spare_.use_count() > 1) spare_ = std::make_shared<LayoutSnapshot>();
+        }
+        LayoutSnapshot& s = *spare_;
+        s.nodes.clear();
+        s.totalNodes = tree_.size();
+        s.version = ++version_;
+
+        const auto layout = tree_.layoutNormalized();
+
+        // Maior profundidade cujos níveis, somados, cabem no limite de desenho
+        std::vector<std::size_t> porNivel;
+        for (const auto& e : layout) {
+            if (static_cast<std::size_t>(e.depth) >= porNivel.size()) porNivel.resize(e.depth + 1, 0);
+            ++porNivel[e.depth];
+        }
+        int maxNivel = static_cast<int>(porNivel.size()) - 1;
+        std::size_t acumulado = 0;
+        for (std::size_t d = 0; d < porNivel.size(); ++d) {
+            acumulado += porNivel[d];
+            if (acumulado > kMaxDrawNodes) { maxNivel = static_cast<int>(d) - 1; break; }
+        }
+        s.truncated = maxNivel < static_cast<int>(porNivel.size()) - 1;
+        const float denom = maxNivel > 0 ? static_cast<float>(maxNivel) : 1.f;
+
+        std::unordered_map<const BST<int>::Node*, int> indice;
+        for (const auto& e : layout) {
+            if (e.depth > maxNivel) continue;
+            indice[e.node] = static_cast<int>(s.nodes.size());
+            s.nodes.push_back(DrawNode{ e.node->key, static_cast<float>(e.x),
+                                        maxNivel > 0 ? e.depth / denom : 0.f, -1, -1 });
+        }
+        for (const auto& e : layout) {
+            if (e.depth > maxNivel) continue;
+            DrawNode& d = s.nodes[indice[e.node]];
+            auto l = indice.find(e.node->left);
+            auto r = indice.find(e.node->right);
+            if (e.node->left && l != indice.end()) d.left = l->second;
+            if (e.node->right && r != indice.end()) d.right = r->second;
+        }
+
+        std::vector<int> valores;
+        switch (trav_) {
+            case Traversal::Pre:  valores = tree_.preOrder();  break;
+            case Traversal::In:   valores = tree_.inOrder();   break;
+            case Traversal::Post: valores = tree_.postOrder(); break;
+        }
+        s.traversalText.clear();
+        s.valueStart.clear();
+        s.valueStart.reserve(valores.size());
+        for (int v : valores) {
+            if (!s.traversalText.empty()) s.traversalText.push_back(' ');
+            s.valueStart.push_back(s.traversalText.size());
+            appendInt(s.traversalText, v);
+        }
+
+        std::lock_guard<std::mutex> lock(snapMtx_);
+        std::swap(front_, spare_);
+    }
+};
+
 int main() {
 
     sf::ContextSettings settings;
@@ -42,29 +296,61 @@ int main() {
     sf::Font font;
     bool hasFont = font.loadFromFile("DejaVuSans.ttf");
 
-    // --- Árvore inicial (apenas para ter algo na tela) ---
-    BST<int> tree;
-    tree.insert_Node(50);
+    // --- Árvore (vive na thread de trabalho; começa com a chave 50) ---
+    TreeWorker worker;
 
     // --- Estado da UI ---
     Traversal trav = Traversal::Pre;
     Mode mode = Mode::View;
-    std::string inputBuffer; // entrada textual para I/D
+    std::string inputBuffer; // entrada textual para I/D/B
 
-    auto computePositions = [&](const sf::Vector2u& sz) {
-        std::unordered_map<const BST<int>::Node*, sf::Vector2f> pos;
+    // Posição exibida de cada chave: anda em direção ao alvo a cada frame,
+    // animando as mudanças de forma da árvore
+    std::unordered_map<int, sf::Vector2f> shown;
+    unsigned long shownVersion = 0;
+
+    auto targetPosition = [&](const DrawNode& d, const sf::Vector2u& sz) {
         const float marginX = sz.x * 0.08f;
         const float marginY = sz.y * 0.12f;
         const float width   = sz.x - 2.f * marginX;
         const float height  = sz.y - 2.f * marginY;
+        return sf::Vector2f(marginX + d.x * width, marginY + d.y * height);
+    };
 
-        auto layout = tree.layoutNormalized();
-        for (const auto& e : layout) {
-            float x = marginX + static_cast<float>(e.x) * width;
-            float y = marginY + static_cast<float>(e.y) * height;
-            pos[e.node] = sf::Vector2f(x, y);
+    // --- Painel do percurso ---
+    // Quebra de linha calculada uma vez por snapshot (ou largura de janela);
+    // a cada frame só as linhas visíveis viram sf::Text
+    constexpr std::size_t kTravLines = 5;
+    std::vector<std::size_t> lineStart; // índice do primeiro valor de cada linha
+    unsigned long linesVersion = 0;
+    std::size_t linesWidth = 0;
+    std::size_t travScroll = 0;         // primeira linha visível
+
+    auto wrapTraversal = [&](const LayoutSnapshot& s, std::size_t maxChars) {
+        lineStart.clear();
+        const std::size_t n = s.valueStart.size();
+        std::size_t ini = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::size_t fim = i + 1 < n ? s.valueStart[i + 1] - 1 : s.traversalText.size();
+            if (i == 0 || fim - s.valueStart[ini] > maxChars) {
+                lineStart.push_back(i);
+                ini = i;
+            }
         }
-        return pos;
+        linesVersion = s.version;
+        linesWidth = maxChars;
+    };
+
+    auto lineText = [&](const LayoutSnapshot& s, std::size_t linha) {
+        const std::size_t a = s.valueStart[lineStart[linha]];
+        const std::size_t b = linha + 1 < lineStart.size()
+            ? s.valueStart[lineStart[linha + 1]] - 1 : s.traversalText.size();
+        return s.traversalText.substr(a, b - a);
+    };
+
+    auto scrollBy = [&](long delta) {
+        const long maxScroll = static_cast<long>(lineStart.size() > kTravLines ? lineStart.size() - kTravLines : 0);
+        travScroll = static_cast<std::size_t>(std::clamp(static_cast<long>(travScroll) + delta, 0L, maxScroll));
     };
 
     auto currentTraversalText = [&] {
@@ -76,13 +362,13 @@ int main() {
         return std::string();
     };
 
-    auto traversalVector = [&] {
-        switch (trav) {
-            case Traversal::Pre:  return tree.preOrder();
-            case Traversal::In:   return tree.inOrder();
-            case Traversal::Post: return tree.postOrder();
-        }
-        return tree.inOrder(); // fallback
+    auto setTraversal = [&](Traversal t) {
+        trav = t;
+        travScroll = 0;
+        Command c;
+        c.type = Command::Type::SetTraversal;
+        c.trav = t;
+        worker.post(c);
     };
 
     while (window.isOpen()) {
@@ -94,17 +380,26 @@ int main() {
                 if (ev.key.code == sf::Keyboard::Escape) {
                     window.close();
                 } else if (ev.key.code == sf::Keyboard::Z) {
-                    trav = Traversal::Pre;
+                    setTraversal(Traversal::Pre);
                 } else if (ev.key.code == sf::Keyboard::X) {
-                    trav = Traversal::In;
+                    setTraversal(Traversal::In);
                 } else if (ev.key.code == sf::Keyboard::C) {
-                    trav = Traversal::Post;
+                    setTraversal(Traversal::Post);
                 } else if (ev.key.code == sf::Keyboard::I) {
                     mode = Mode::Insert;
                     inputBuffer.clear();
                 } else if (ev.key.code == sf::Keyboard::D) {
                     mode = Mode::Delete;
                     inputBuffer.clear();
+                } else if (ev.key.code == sf::Keyboard::B) {
+                    mode = Mode::Bulk;
+                    inputBuffer.clear();
+                } else if (ev.key.code == sf::Keyboard::L) {
+                    // Carrega chaves (inteiros separados por espaço) de keys.txt
+                    Command c;
+                    c.type = Command::Type::FileBulk;
+                    c.path = "keys.txt";
+                    worker.post(c);
                 } else if (ev.key.code == sf::Keyboard::V) {
                     mode = Mode::View;
                     inputBuffer.clear();
@@ -112,23 +407,43 @@ int main() {
                     if (!inputBuffer.empty()) {
                         try {
                             int value = std::stoi(inputBuffer);
-                            if (mode == Mode::Insert) tree.insert_Node(value);
-                            else if (mode == Mode::Delete) tree.delete_Node(value);
+                            Command c;
+                            c.value = value;
+                            if (mode == Mode::Delete) c.type = Command::Type::Delete;
+                            else if (mode == Mode::Bulk) c.type = Command::Type::RandomBulk;
+                            if (mode != Mode::View) worker.post(c);
                         } catch (...) { /* entrada inválida: ignorar */ }
                         inputBuffer.clear();
                     }
                 } else if (ev.key.code == sf::Keyboard::Backspace) {
                     if (!inputBuffer.empty()) inputBuffer.pop_back();
+                } else if (ev.key.code == sf::Keyboard::Up) {
+                    scrollBy(-1);
+                } else if (ev.key.code == sf::Keyboard::Down) {
+                    scrollBy(1);
+                } else if (ev.key.code == sf::Keyboard::PageUp) {
+                    scrollBy(-static_cast<long>(kTravLines));
+                } else if (ev.key.code == sf::Keyboard::PageDown) {
+                    scrollBy(static_cast<long>(kTravLines));
+                } else if (ev.key.code == sf::Keyboard::Home) {
+                    travScroll = 0;
+                } else if (ev.key.code == sf::Keyboard::End) {
+                    scrollBy(static_cast<long>(lineStart.size()));
                 }
             }
 
+            // Roda do mouse rola o painel do percurso
+            if (ev.type == sf::Event::MouseWheelScrolled) {
+                scrollBy(ev.mouseWheelScroll.delta > 0 ? -1 : 1);
+            }
+
             // Captura de caracteres para o buffer (números e sinal '-')
             if (ev.type == sf::Event::TextEntered) {
                 const sf::Uint32 ch = ev.text.unicode;
-                if (mode == Mode::Insert || mode == Mode::Delete) {
+                if (mode == Mode::Insert || mode == Mode::Delete || mode == Mode::Bulk) {
                     if (ch == 8 || ch == 127) { // backspace/delete
                         if (!inputBuffer.empty()) inputBuffer.pop_back();
-                    } else if (ch == '-' && inputBuffer.empty()) {
+                    } else if (ch == '-' && inputBuffer.empty() && mode != Mode::Bulk) {
                         inputBuffer.push_back('-');
                     } else if (ch >= '0' && ch <= '9') {
                         inputBuffer.push_back(static_cast<char>(ch));
@@ -139,8 +454,38 @@ int main() {
 
         window.clear(sf::Color(24, 24, 24));
 
-        // Recalcula posições a cada frame (simples e robusto)
-        auto pos = computePositions(window.getSize());
+        // Último layout publicado pela thread de trabalho
+        const auto snap = worker.snapshot();
+        const auto winSize = window.getSize();
+
+        // Novo layout: chaves que saíram do desenho deixam a animação e as
+        // que entraram nascem na posição exibida do ancestral mais próximo
+        if (snap->version != shownVersion) {
+            const auto& nodes = snap->nodes;
+            std::vector<int> pai(nodes.size(), -1);
+            for (std::size_t i = 0; i < nodes.size(); ++i) {
+                if (nodes[i].left >= 0) pai[nodes[i].left] = static_cast<int>(i);
+                if (nodes[i].right >= 0) pai[nodes[i].right] = static_cast<int>(i);
+            }
+            std::unordered_map<int, sf::Vector2f> vivos;
+            vivos.reserve(nodes.size());
+            for (std::size_t i = 0; i < nodes.size(); ++i) {
+                int a = static_cast<int>(i);
+                while (a >= 0 && !shown.count(nodes[a].key)) a = pai[a];
+                vivos[nodes[i].key] = a >= 0 ? shown[nodes[a].key] : targetPosition(nodes[i], winSize);
+            }
+            shown.swap(vivos);
+            shownVersion = snap->version;
+        }
+
+        // Aproxima cada posição exibida do alvo (suavização exponencial)
+        std::vector<sf::Vector2f> pos(snap->nodes.size());
+        for (std::size_t i = 0; i < snap->nodes.size(); ++i) {
+            const auto alvo = targetPosition(snap->nodes[i], winSize);
+            sf::Vector2f& p = shown[snap->nodes[i].key];
+            p += (alvo - p) * 0.2f;
+            pos[i] = p;
+        }
 
         auto drawEdge = [&](const sf::Vector2f& a, const sf::Vector2f& b, float thickness = 2.0f) {
             sf::Vector2f d = b - a;
@@ -156,28 +501,19 @@ int main() {
         };
 
         //    desenhe as arestas ANTES dos nós
-        for (const auto& it : pos) {
-            const auto* n = it.first;
-            const auto& p = it.second;
-
-            if (n->left) {
-                auto f = pos.find(n->left);
-                if (f != pos.end()) drawEdge(p, f->second);  // espessura default 2 px
-            }
-            if (n->right) {
-                auto f = pos.find(n->right);
-                if (f != pos.end()) drawEdge(p, f->second);
-            }
+        for (std::size_t i = 0; i < snap->nodes.size(); ++i) {
+            const auto& n = snap->nodes[i];
+            if (n.left >= 0) drawEdge(pos[i], pos[n.left]);  // espessura default 2 px
+            if (n.right >= 0) drawEdge(pos[i], pos[n.right]);
         }
 
         // Heurística de raio por resolução e quantidade de nós
-        const float baseR = std::max(10.f, std::min(window.getSize().x, window.getSize().y) * 0.018f);
-        const float r = baseR * std::max(0.6f, 1.5f - 0.02f * static_cast<float>(tree.numberOfNodes()));
+        const float baseR = std::max(10.f, std::min(winSize.x, winSize.y) * 0.018f);
+        const float r = baseR * std::max(0.6f, 1.5f - 0.02f * static_cast<float>(snap->nodes.size()));
 
         // Desenha nós
-        for (const auto& it : pos) {
-            const auto* n = it.first;
-            const auto& p = it.second;
+        for (std::size_t i = 0; i < snap->nodes.size(); ++i) {
+            const auto& p = pos[i];
 
             sf::CircleShape circ(r);
             circ.setPointCount(std::clamp<int>(static_cast<int>(r * 2), 20, 120));
@@ -189,7 +525,7 @@ int main() {
             window.draw(circ);
 
             if (hasFont) {
-                sf::Text t(std::to_string(n->key), font, static_cast<unsigned>(std::max(12.f, r)));
+                sf::Text t(std::to_string(snap->nodes[i].key), font, static_cast<unsigned>(std::max(12.f, r)));
                 t.setFillColor(sf::Color::White);
                 const auto bounds = t.getLocalBounds();
                 t.setOrigin(bounds.left + bounds.width / 2.f, bounds.top + bounds.height / 2.f);
@@ -200,20 +536,49 @@ int main() {
 
         if (hasFont) {
             const float pad = 12.f;
-            const unsigned uiSize = static_cast<unsigned>(std::max(14.f, window.getSize().y * 0.022f));
+            const unsigned uiSize = static_cast<unsigned>(std::max(14.f, winSize.y * 0.022f));
 
             std::string modeStr = "Modo: ";
             if (mode == Mode::View)   modeStr += "Visualização [V]";
             if (mode == Mode::Insert) modeStr += "Inserção [I]";
             if (mode == Mode::Delete) modeStr += "Deleção [D]";
+            if (mode == Mode::Bulk)   modeStr += "Lote aleatório [B] (N chaves, até " + std::to_string(TreeWorker::kBulkMax) + ")";
+            modeStr += "   |  Nós: " + std::to_string(snap->totalNodes);
+            if (snap->truncated) modeStr += " (níveis profundos ocultos)";
+
+            const std::size_t total = worker.bulkTotal();
+            if (total > 0) {
+                const std::size_t feito = worker.bulkDone();
+                modeStr += "   |  Carregando: " + std::to_string(feito * 100 / total) + "%";
+            }
+            const std::string erro = worker.lastError();
+            if (!erro.empty()) modeStr += "   |  Erro: " + erro;
+
+            // Largura média de glifo ~0.6 do tamanho da fonte
+            const std::size_t maxChars = std::max<std::size_t>(
+                16, static_cast<std::size_t>((winSize.x - 2 * pad) / (uiSize * 0.6f)));
+            if (linesVersion != snap->version || linesWidth != maxChars) {
+                wrapTraversal(*snap, maxChars);
+                scrollBy(0); // reajusta a rolagem ao novo número de linhas
+            }
 
-            const auto travVec = traversalVector();
-            std::string travStr = currentTraversalText() + joinInts(travVec);
+            std::string travStr = currentTraversalText() + std::to_string(snap->valueStart.size()) + " valores";
+            if (lineStart.size() > kTravLines) {
+                travStr += "  (linhas " + std::to_string(travScroll + 1) + "-"
+                         + std::to_string(std::min(lineStart.size(), travScroll + kTravLines))
+                         + " de " + std::to_string(lineStart.size()) + ", setas/PgUp/PgDn)";
+            }
 
-            if (!inputBuffer.empty() && (mode == Mode::Insert || mode == Mode::Delete)) {
+            if (!inputBuffer.empty() && mode != Mode::View) {
                 travStr += "   |  Valor: " + inputBuffer + "  (Enter confirma)";
             }
 
+            std::string visivel;
+            for (std::size_t l = travScroll; l < lineStart.size() && l < travScroll + kTravLines; ++l) {
+                if (!visivel.empty()) visivel.push_back('\n');
+                visivel += lineText(*snap, l);
+            }
+
             sf::Text t1; 
             t1.setFont(font);
             t1.setCharacterSize(uiSize);
@@ -229,12 +594,21 @@ int main() {
             t1.setFillColor(sf::Color::White);
             t2.setFillColor(sf::Color(220, 220, 220));
 
+            sf::Text t3;
+            t3.setFont(font);
+            t3.setCharacterSize(uiSize);
+            t3.setFillColor(sf::Color(190, 190, 190));
+            t3.setString(U8(visivel));
+
             t1.setPosition(pad, pad);
             t2.setPosition(pad, pad + t1.getLocalBounds().height + 10.f);
+            t3.setPosition(pad, pad + t1.getLocalBounds().height + t2.getLocalBounds().height + 20.f);
 
             // Fundo semitransparente para legibilidade
-            const float w = std::max(t1.getLocalBounds().width, t2.getLocalBounds().width) + 2 * pad;
-            const float h = (t1.getLocalBounds().height + t2.getLocalBounds().height) + 3 * pad + 10.f;
+            const float w = std::max({ t1.getLocalBounds().width, t2.getLocalBounds().width,
+                                       t3.getLocalBounds().width }) + 2 * pad;
+            const float h = (t1.getLocalBounds().height + t2.getLocalBounds().height
+                             + t3.getLocalBounds().height) + 3 * pad + 20.f;
 
             sf::RectangleShape bg(sf::Vector2f(w, h));
             bg.setPosition(0.f, 0.f);
@@ -243,6 +617,20 @@ int main() {
             window.draw(bg);
             window.draw(t1);
             window.draw(t2);
+            window.draw(t3);
+
+            // Barra de progresso do lote
+            if (total > 0) {
+                const float larg = winSize.x * 0.3f;
+                sf::RectangleShape fundo(sf::Vector2f(larg, 8.f));
+                fundo.setPosition(pad, h + pad);
+                fundo.setFillColor(sf::Color(60, 60, 60));
+                sf::RectangleShape barra(sf::Vector2f(larg * worker.bulkDone() / total, 8.f));
+                barra.setPosition(pad, h + pad);
+                barra.setFillColor(sf::Color(70, 130, 180));
+                window.draw(fundo);
+                window.draw(barra);
+            }
         }
 
         window.display();